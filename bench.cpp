@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "libmychecker/checker.h"
+#include "libmychecker/models.h"
+
+// Benchmarks the checker on the model families of models.h:
+//
+//     bench [family [size]]
+//
+// where family is ring, grid, random, tree or philosophers, and size its
+// parameter (states, side length, states, depth, philosophers). Without
+// arguments every family runs at its default size. Prints a JSON array with
+// one object per model; for every operator of a fixed property set it holds
+// the time to check it on a fresh Labelling, the resulting states and
+// edges per second, and the peak resident set size during the check (in
+// KiB, model included, 0 where /proc is missing). The peak is reset before
+// each check; where the kernel does not allow that, it is the peak of the
+// process so far.
+
+struct Family {
+    std::string name;
+    int size;
+    std::function<Kripke(int)> build;
+};
+
+// Resets the peak resident set size of the process to its current size.
+static void reset_peak_rss() {
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+}
+
+// The peak resident set size since the last reset, VmHWM in
+// /proc/self/status.
+static long peak_rss_kb() {
+    std::ifstream status("/proc/self/status");
+    std::string key;
+    while (status >> key) {
+        if (key == "VmHWM:") {
+            long kb = 0;
+            status >> kb;
+            return kb;
+        }
+        std::getline(status, key);
+    }
+    return 0;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    return d.count();
+}
+
+static std::string json_string(const std::string& s) {
+    std::string result = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result + "\"";
+}
+
+static void report(const std::string& name, const std::string& formula,
+                   double seconds, long peak_rss_kb, const CSRGraph& G,
+                   bool last) {
+    // Keeps the rates finite, as JSON has no infinity.
+    double rate = 1 / std::max(seconds, 1e-9);
+    std::cout << "    {\"operator\": " << json_string(name)
+              << ", \"formula\": " << json_string(formula)
+              << ", \"seconds\": " << seconds
+              << ", \"states_per_second\": " << G.size() * rate
+              << ", \"edges_per_second\": " << G.num_edges() * rate
+              << ", \"peak_rss_kb\": " << peak_rss_kb << "}"
+              << (last ? "\n" : ",\n");
+}
+
+static void run(const Family& family, int size) {
+    auto start = std::chrono::steady_clock::now();
+    Kripke kripke = family.build(size);
+    const CSRGraph& G = kripke.csr();
+    kripke.predecessors();
+    double build = seconds_since(start);
+
+    std::cout << "  {\"model\": " << json_string(family.name)
+              << ", \"size\": " << size << ", \"states\": " << G.size()
+              << ", \"edges\": " << G.num_edges()
+              << ", \"build_seconds\": " << build << ",\n";
+    std::cout << "   \"operators\": [\n";
+
+    reset_peak_rss();
+    start = std::chrono::steady_clock::now();
+    SCCDecomposition sccs;
+    compute_SCCs(G, sccs);
+    report("scc", "", seconds_since(start), peak_rss_kb(), G, false);
+
+    auto p = std::make_shared<CTL::AtomicProposition>("p");
+    auto q = std::make_shared<CTL::AtomicProposition>("q");
+    auto AG = [](std::shared_ptr<Formula> f) {
+        return std::make_shared<CTL::A>(std::make_shared<CTL::G>(f));
+    };
+    struct Property {
+        std::string name;
+        std::shared_ptr<Formula> formula;
+        bool fair;
+    };
+    std::vector<Property> properties = {
+        {"EX", CTL::EX(p), false},
+        {"EU", CTL::EU(p, q), false},
+        {"EG", CTL::EG(p), false},
+        {"AF", CTL::AF(q), false},
+        {"AU", CTL::AU(p, q), false},
+        {"AG EF", AG(CTL::EF(q)), false},
+        {"fair EG", CTL::EG(std::make_shared<CTL::Bool>(true)), true},
+        {"fair AF", CTL::AF(q), true},
+    };
+    // Fairness: p holds infinitely often.
+    std::vector<std::unordered_set<int>> F(1);
+    kripke.ap_states("p")->for_each([&](int v) { F[0].insert(G.id(v)); });
+    std::vector<std::unordered_set<int>> none;
+
+    for (std::size_t i = 0; i < properties.size(); i++) {
+        const Property& property = properties[i];
+        reset_peak_rss();
+        Labelling L;
+        start = std::chrono::steady_clock::now();
+        modelcheck(kripke, property.formula, L, property.fair ? F : none);
+        double seconds = seconds_since(start);
+        report(property.name, property.formula->str(), seconds,
+               peak_rss_kb(), G, i + 1 == properties.size());
+    }
+    std::cout << "   ]}";
+}
+
+int main(int argc, char** argv) {
+    std::vector<Family> families = {
+        {"ring", 1 << 20, [](int n) { return ring_model(n); }},
+        {"grid", 1024, [](int w) { return grid_model(w, w); }},
+        {"random", 1 << 20, [](int n) { return random_model(n, 4, 1); }},
+        {"tree", 20, [](int depth) { return tree_model(depth); }},
+        {"philosophers", 10, [](int n) { return philosophers_model(n); }},
+    };
+    if (argc > 1) {
+        std::vector<Family> selected;
+        for (const Family& family : families) {
+            if (family.name == argv[1]) {
+                selected.push_back(family);
+            }
+        }
+        if (selected.empty()) {
+            std::cerr << "Unknown model family " << argv[1] << "\n";
+            return 1;
+        }
+        if (argc > 2) {
+            selected[0].size = std::atoi(argv[2]);
+        }
+        families = selected;
+    }
+
+    std::cout << "[\n";
+    for (std::size_t i = 0; i < families.size(); i++) {
+        run(families[i], families[i].size);
+        std::cout << (i + 1 == families.size() ? "\n" : ",\n");
+    }
+    std::cout << "]\n";
+}
@@ -10,16 +10,18 @@ int main() {
         {0, {}}, {1, {"p"}}, {2, {"q"}}};
     Kripke kripke(S, S0, R, kL);
 
-    std::unordered_map<std::string, std::unordered_set<int>> L;
+    Labelling L;
     std::vector<std::unordered_set<int>> F;
     std::shared_ptr<Formula> formula = std::make_shared<CTL::Bool>("true");
     modelcheck(kripke, formula, L, F);
 
-    for (auto const &t : L) {
-        std::cout << t.first << ": [";
-        for (int i : t.second) {
-            std::cout << i << ", ";
+    for (int id = 0; id < L.formulas.size(); id++) {
+        if (!L.contains(id)) {
+            continue;
         }
+        std::cout << L.formulas.str(id) << ": [";
+        L[id].for_each(
+            [&](int i) { std::cout << kripke.csr().id(i) << ", "; });
         std::cout << "]\n";
     }
 }
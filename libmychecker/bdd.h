@@ -0,0 +1,587 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+class BDDManager;
+
+// A reference-counted handle on a node of a BDDManager. Nodes reachable from
+// a live handle survive garbage collection.
+class BDD {
+   public:
+    BDD() : _mgr(nullptr), _node(0) {}
+    BDD(BDDManager* mgr, std::uint32_t node);
+    BDD(const BDD& other);
+    BDD& operator=(const BDD& other);
+    ~BDD();
+
+    std::uint32_t node() const { return _node; }
+    BDDManager* manager() const { return _mgr; }
+
+    bool is_zero() const { return _node == 0; }
+    bool is_one() const { return _node == 1; }
+
+    bool operator==(const BDD& other) const { return _node == other._node; }
+    bool operator!=(const BDD& other) const { return _node != other._node; }
+
+    BDD operator&(const BDD& other) const;
+    BDD operator|(const BDD& other) const;
+    BDD operator!() const;
+
+   private:
+    BDDManager* _mgr;
+    std::uint32_t _node;
+};
+
+// A reduced ordered BDD package without complement edges. Nodes live in one
+// array and are hash-consed through a chained unique table; results of
+// binary operations, quantification and renaming are memoised in a
+// direct-mapped computed cache. Nodes not reachable from a live BDD handle
+// are reclaimed by a mark-and-sweep collection that runs between top-level
+// operations once the node count has doubled since the last collection.
+class BDDManager {
+   public:
+    explicit BDDManager(int num_vars, std::size_t cache_size = 1 << 18)
+        : _num_vars(num_vars),
+          _free(none),
+          _num_free(0),
+          _gc_threshold(1 << 16),
+          _depth(0) {
+        if (num_vars < 0 || num_vars >= int(terminal_var)) {
+            throw std::runtime_error("Invalid number of BDD variables");
+        }
+        _nodes.push_back(Node{terminal_var, 0, 0, none, 1});
+        _nodes.push_back(Node{terminal_var, 1, 1, none, 1});
+        _buckets.assign(1 << 12, none);
+        std::size_t size = 1;
+        while (size < cache_size) {
+            size <<= 1;
+        }
+        _cache.assign(size, CacheEntry{none, 0, 0, 0, 0});
+    }
+
+    BDDManager(const BDDManager&) = delete;
+    BDDManager& operator=(const BDDManager&) = delete;
+
+    int num_vars() const { return _num_vars; }
+
+    std::size_t num_nodes() const { return _nodes.size() - _num_free; }
+
+    BDD zero() { return BDD(this, 0); }
+    BDD one() { return BDD(this, 1); }
+
+    BDD var(int i) { return BDD(this, mk(i, 0, 1)); }
+    BDD nvar(int i) { return BDD(this, mk(i, 1, 0)); }
+
+    BDD apply_and(const BDD& a, const BDD& b) {
+        Operation op(this);
+        return BDD(this, and_rec(a.node(), b.node()));
+    }
+
+    BDD apply_or(const BDD& a, const BDD& b) {
+        Operation op(this);
+        return BDD(this, or_rec(a.node(), b.node()));
+    }
+
+    BDD apply_not(const BDD& a) {
+        Operation op(this);
+        return BDD(this, not_rec(a.node()));
+    }
+
+    // The conjunction of the positive literals of `vars`.
+    BDD cube(const std::vector<int>& vars) {
+        std::vector<int> sorted(vars);
+        std::sort(sorted.begin(), sorted.end());
+        std::uint32_t r = 1;
+        for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
+            r = mk(*it, 0, r);
+        }
+        return BDD(this, r);
+    }
+
+    // Existentially quantifies the variables of `cube` out of `a`.
+    BDD exists(const BDD& a, const BDD& cube) {
+        Operation op(this);
+        return BDD(this, exists_rec(a.node(), cube.node()));
+    }
+
+    // Relational product: exists cube. a & b, without building a & b.
+    BDD and_exists(const BDD& a, const BDD& b, const BDD& cube) {
+        Operation op(this);
+        return BDD(this, and_exists_rec(a.node(), b.node(), cube.node()));
+    }
+
+    // Renames every variable v of `a` to v + offset. Since the mapping is
+    // monotone the variable order is preserved.
+    BDD shift(const BDD& a, int offset) {
+        Operation op(this);
+        return BDD(this, shift_rec(a.node(), offset));
+    }
+
+    // Builds the set of assignments listed in `keys`, which must be sorted
+    // and unique. Bit nbits-1-i of a key (most significant first) is the
+    // value of variable vars[i].
+    BDD from_minterms(const std::vector<std::uint64_t>& keys,
+                      const std::vector<int>& vars) {
+        Operation op(this);
+        return BDD(this, minterms_rec(keys.data(), keys.data() + keys.size(),
+                                      0, vars));
+    }
+
+    // The assignments of `vars` (most significant first) that encode a
+    // number strictly smaller than `bound`.
+    BDD less_than(std::uint64_t bound, const std::vector<int>& vars) {
+        int k = vars.size();
+        if (k < 64 && bound >= (std::uint64_t(1) << k)) {
+            return one();
+        }
+        std::uint32_t r = 0;
+        for (int i = k - 1; i >= 0; i--) {
+            bool bit = (bound >> (k - 1 - i)) & 1;
+            r = bit ? mk(vars[i], 1, r) : mk(vars[i], r, 0);
+        }
+        return BDD(this, r);
+    }
+
+    // Calls f(key) for every assignment of `vars` that satisfies `a`, where
+    // `a` depends on no other variables; keys are encoded as in
+    // from_minterms and enumerated in increasing order.
+    template <typename Fn>
+    void for_each_minterm(const BDD& a, const std::vector<int>& vars, Fn f) {
+        minterms_enum(a.node(), 0, 0, vars, f);
+    }
+
+    void gc() {
+        std::vector<char> marked(_nodes.size(), 0);
+        std::vector<std::uint32_t> stack;
+        marked[0] = marked[1] = 1;
+        for (std::uint32_t i = 2; i < _nodes.size(); i++) {
+            if (_nodes[i].ref > 0 && _nodes[i].var != free_var) {
+                stack.push_back(i);
+            }
+        }
+        while (!stack.empty()) {
+            std::uint32_t i = stack.back();
+            stack.pop_back();
+            if (marked[i]) {
+                continue;
+            }
+            marked[i] = 1;
+            stack.push_back(_nodes[i].low);
+            stack.push_back(_nodes[i].high);
+        }
+
+        std::fill(_buckets.begin(), _buckets.end(), none);
+        _free = none;
+        _num_free = 0;
+        for (std::uint32_t i = _nodes.size() - 1; i >= 2; i--) {
+            Node& n = _nodes[i];
+            if (marked[i]) {
+                std::uint32_t b = bucket(n.var, n.low, n.high);
+                n.next = _buckets[b];
+                _buckets[b] = i;
+            } else {
+                n.var = free_var;
+                n.ref = 0;
+                n.next = _free;
+                _free = i;
+                _num_free++;
+            }
+        }
+        std::fill(_cache.begin(), _cache.end(), CacheEntry{none, 0, 0, 0, 0});
+        _gc_threshold = std::max(_gc_threshold, 2 * num_nodes());
+    }
+
+   private:
+    friend class BDD;
+
+    static constexpr std::uint32_t none = 0xffffffff;
+    static constexpr std::uint32_t terminal_var = 0x7fffffff;
+    static constexpr std::uint32_t free_var = 0x7ffffffe;
+
+    typedef enum { OpAnd, OpOr, OpNot, OpExists, OpAndExists, OpShift } Op;
+
+    struct Node {
+        std::uint32_t var;
+        std::uint32_t low;
+        std::uint32_t high;
+        std::uint32_t next;
+        std::uint32_t ref;
+    };
+
+    struct CacheEntry {
+        std::uint32_t op;
+        std::uint32_t a;
+        std::uint32_t b;
+        std::uint32_t c;
+        std::uint32_t result;
+    };
+
+    // Marks a top-level operation: collection only happens when no
+    // operation is in progress, so unreferenced intermediate nodes of a
+    // running recursion are never reclaimed.
+    class Operation {
+       public:
+        explicit Operation(BDDManager* mgr) : _mgr(mgr) {
+            if (_mgr->_depth++ == 0 &&
+                _mgr->num_nodes() > _mgr->_gc_threshold) {
+                _mgr->gc();
+            }
+        }
+        ~Operation() { _mgr->_depth--; }
+
+       private:
+        BDDManager* _mgr;
+    };
+
+    int _num_vars;
+    std::vector<Node> _nodes;
+    std::vector<std::uint32_t> _buckets;
+    std::vector<CacheEntry> _cache;
+    std::uint32_t _free;
+    std::size_t _num_free;
+    std::size_t _gc_threshold;
+    int _depth;
+
+    void ref(std::uint32_t i) { _nodes[i].ref++; }
+    void deref(std::uint32_t i) { _nodes[i].ref--; }
+
+    std::uint32_t var_of(std::uint32_t i) const { return _nodes[i].var; }
+
+    static std::uint64_t hash(std::uint64_t a, std::uint64_t b,
+                              std::uint64_t c, std::uint64_t d) {
+        const std::uint64_t k = 0x9e3779b97f4a7c15ULL;
+        std::uint64_t h = (((a * k + b) * k + c) * k + d) * k;
+        return h >> 32;
+    }
+
+    std::uint32_t bucket(std::uint32_t var, std::uint32_t low,
+                         std::uint32_t high) const {
+        return hash(var, low, high, 0) & (_buckets.size() - 1);
+    }
+
+    std::uint32_t mk(std::uint32_t var, std::uint32_t low,
+                     std::uint32_t high) {
+        if (low == high) {
+            return low;
+        }
+        std::uint32_t b = bucket(var, low, high);
+        for (std::uint32_t i = _buckets[b]; i != none; i = _nodes[i].next) {
+            const Node& n = _nodes[i];
+            if (n.var == var && n.low == low && n.high == high) {
+                return i;
+            }
+        }
+
+        std::uint32_t i;
+        if (_free != none) {
+            i = _free;
+            _free = _nodes[i].next;
+            _num_free--;
+            _nodes[i] = Node{var, low, high, _buckets[b], 0};
+        } else {
+            if (_nodes.size() >= terminal_var) {
+                throw std::runtime_error("BDD node table is full");
+            }
+            i = _nodes.size();
+            _nodes.push_back(Node{var, low, high, _buckets[b], 0});
+        }
+        _buckets[b] = i;
+        if (num_nodes() > 2 * _buckets.size()) {
+            grow_buckets();
+        }
+        return i;
+    }
+
+    void grow_buckets() {
+        _buckets.assign(_buckets.size() * 2, none);
+        for (std::uint32_t i = 2; i < _nodes.size(); i++) {
+            Node& n = _nodes[i];
+            if (n.var != free_var) {
+                std::uint32_t b = bucket(n.var, n.low, n.high);
+                n.next = _buckets[b];
+                _buckets[b] = i;
+            }
+        }
+    }
+
+    CacheEntry& cache_slot(std::uint32_t op, std::uint32_t a, std::uint32_t b,
+                           std::uint32_t c) {
+        return _cache[hash(op, a, b, c) & (_cache.size() - 1)];
+    }
+
+    bool cache_lookup(std::uint32_t op, std::uint32_t a, std::uint32_t b,
+                      std::uint32_t c, std::uint32_t& result) {
+        const CacheEntry& e = cache_slot(op, a, b, c);
+        if (e.op == op && e.a == a && e.b == b && e.c == c) {
+            result = e.result;
+            return true;
+        }
+        return false;
+    }
+
+    void cache_insert(std::uint32_t op, std::uint32_t a, std::uint32_t b,
+                      std::uint32_t c, std::uint32_t result) {
+        cache_slot(op, a, b, c) = CacheEntry{op, a, b, c, result};
+    }
+
+    std::uint32_t and_rec(std::uint32_t a, std::uint32_t b) {
+        if (a == 0 || b == 0) {
+            return 0;
+        }
+        if (a == 1 || a == b) {
+            return b;
+        }
+        if (b == 1) {
+            return a;
+        }
+        if (a > b) {
+            std::swap(a, b);
+        }
+        std::uint32_t r;
+        if (cache_lookup(OpAnd, a, b, 0, r)) {
+            return r;
+        }
+        std::uint32_t va = var_of(a), vb = var_of(b);
+        std::uint32_t v = std::min(va, vb);
+        std::uint32_t a0 = va == v ? _nodes[a].low : a;
+        std::uint32_t a1 = va == v ? _nodes[a].high : a;
+        std::uint32_t b0 = vb == v ? _nodes[b].low : b;
+        std::uint32_t b1 = vb == v ? _nodes[b].high : b;
+        std::uint32_t low = and_rec(a0, b0);
+        std::uint32_t high = and_rec(a1, b1);
+        r = mk(v, low, high);
+        cache_insert(OpAnd, a, b, 0, r);
+        return r;
+    }
+
+    std::uint32_t or_rec(std::uint32_t a, std::uint32_t b) {
+        if (a == 1 || b == 1) {
+            return 1;
+        }
+        if (a == 0 || a == b) {
+            return b;
+        }
+        if (b == 0) {
+            return a;
+        }
+        if (a > b) {
+            std::swap(a, b);
+        }
+        std::uint32_t r;
+        if (cache_lookup(OpOr, a, b, 0, r)) {
+            return r;
+        }
+        std::uint32_t va = var_of(a), vb = var_of(b);
+        std::uint32_t v = std::min(va, vb);
+        std::uint32_t a0 = va == v ? _nodes[a].low : a;
+        std::uint32_t a1 = va == v ? _nodes[a].high : a;
+        std::uint32_t b0 = vb == v ? _nodes[b].low : b;
+        std::uint32_t b1 = vb == v ? _nodes[b].high : b;
+        std::uint32_t low = or_rec(a0, b0);
+        std::uint32_t high = or_rec(a1, b1);
+        r = mk(v, low, high);
+        cache_insert(OpOr, a, b, 0, r);
+        return r;
+    }
+
+    std::uint32_t not_rec(std::uint32_t a) {
+        if (a < 2) {
+            return 1 - a;
+        }
+        std::uint32_t r;
+        if (cache_lookup(OpNot, a, 0, 0, r)) {
+            return r;
+        }
+        std::uint32_t v = var_of(a);
+        std::uint32_t a0 = _nodes[a].low, a1 = _nodes[a].high;
+        std::uint32_t low = not_rec(a0);
+        std::uint32_t high = not_rec(a1);
+        r = mk(v, low, high);
+        cache_insert(OpNot, a, 0, 0, r);
+        return r;
+    }
+
+    std::uint32_t exists_rec(std::uint32_t a, std::uint32_t cube) {
+        if (a < 2 || cube == 1) {
+            return a;
+        }
+        std::uint32_t va = var_of(a);
+        while (cube != 1 && var_of(cube) < va) {
+            cube = _nodes[cube].high;
+        }
+        if (cube == 1) {
+            return a;
+        }
+        std::uint32_t r;
+        if (cache_lookup(OpExists, a, cube, 0, r)) {
+            return r;
+        }
+        std::uint32_t a0 = _nodes[a].low, a1 = _nodes[a].high;
+        if (var_of(cube) == va) {
+            std::uint32_t rest = _nodes[cube].high;
+            std::uint32_t low = exists_rec(a0, rest);
+            std::uint32_t high = exists_rec(a1, rest);
+            r = or_rec(low, high);
+        } else {
+            std::uint32_t low = exists_rec(a0, cube);
+            std::uint32_t high = exists_rec(a1, cube);
+            r = mk(va, low, high);
+        }
+        cache_insert(OpExists, a, cube, 0, r);
+        return r;
+    }
+
+    std::uint32_t and_exists_rec(std::uint32_t a, std::uint32_t b,
+                                 std::uint32_t cube) {
+        if (a == 0 || b == 0) {
+            return 0;
+        }
+        if (a == 1 && b == 1) {
+            return 1;
+        }
+        if (cube == 1) {
+            return and_rec(a, b);
+        }
+        if (a == 1 || a == b) {
+            return exists_rec(b, cube);
+        }
+        if (b == 1) {
+            return exists_rec(a, cube);
+        }
+        if (a > b) {
+            std::swap(a, b);
+        }
+        std::uint32_t va = var_of(a), vb = var_of(b);
+        std::uint32_t v = std::min(va, vb);
+        while (cube != 1 && var_of(cube) < v) {
+            cube = _nodes[cube].high;
+        }
+        if (cube == 1) {
+            return and_rec(a, b);
+        }
+        std::uint32_t r;
+        if (cache_lookup(OpAndExists, a, b, cube, r)) {
+            return r;
+        }
+        std::uint32_t a0 = va == v ? _nodes[a].low : a;
+        std::uint32_t a1 = va == v ? _nodes[a].high : a;
+        std::uint32_t b0 = vb == v ? _nodes[b].low : b;
+        std::uint32_t b1 = vb == v ? _nodes[b].high : b;
+        if (var_of(cube) == v) {
+            std::uint32_t rest = _nodes[cube].high;
+            std::uint32_t low = and_exists_rec(a0, b0, rest);
+            if (low == 1) {
+                r = 1;
+            } else {
+                std::uint32_t high = and_exists_rec(a1, b1, rest);
+                r = or_rec(low, high);
+            }
+        } else {
+            std::uint32_t low = and_exists_rec(a0, b0, cube);
+            std::uint32_t high = and_exists_rec(a1, b1, cube);
+            r = mk(v, low, high);
+        }
+        cache_insert(OpAndExists, a, b, cube, r);
+        return r;
+    }
+
+    std::uint32_t shift_rec(std::uint32_t a, int offset) {
+        if (a < 2) {
+            return a;
+        }
+        std::uint32_t r;
+        if (cache_lookup(OpShift, a, offset, 0, r)) {
+            return r;
+        }
+        std::uint32_t v = var_of(a);
+        std::uint32_t a0 = _nodes[a].low, a1 = _nodes[a].high;
+        std::uint32_t low = shift_rec(a0, offset);
+        std::uint32_t high = shift_rec(a1, offset);
+        r = mk(v + offset, low, high);
+        cache_insert(OpShift, a, offset, 0, r);
+        return r;
+    }
+
+    std::uint32_t minterms_rec(const std::uint64_t* first,
+                               const std::uint64_t* last, int level,
+                               const std::vector<int>& vars) {
+        if (first == last) {
+            return 0;
+        }
+        int k = vars.size();
+        if (level == k) {
+            return 1;
+        }
+        int bit = k - 1 - level;
+        const std::uint64_t* mid =
+            std::partition_point(first, last, [bit](std::uint64_t key) {
+                return !((key >> bit) & 1);
+            });
+        std::uint32_t low = minterms_rec(first, mid, level + 1, vars);
+        std::uint32_t high = minterms_rec(mid, last, level + 1, vars);
+        return mk(vars[level], low, high);
+    }
+
+    template <typename Fn>
+    void minterms_enum(std::uint32_t a, int level, std::uint64_t prefix,
+                       const std::vector<int>& vars, Fn& f) {
+        if (a == 0) {
+            return;
+        }
+        int k = vars.size();
+        if (level == k) {
+            f(prefix);
+            return;
+        }
+        std::uint32_t v = vars[level];
+        if (var_of(a) == v) {
+            std::uint32_t a0 = _nodes[a].low, a1 = _nodes[a].high;
+            minterms_enum(a0, level + 1, prefix << 1, vars, f);
+            minterms_enum(a1, level + 1, (prefix << 1) | 1, vars, f);
+        } else {
+            minterms_enum(a, level + 1, prefix << 1, vars, f);
+            minterms_enum(a, level + 1, (prefix << 1) | 1, vars, f);
+        }
+    }
+};
+
+inline BDD::BDD(BDDManager* mgr, std::uint32_t node) : _mgr(mgr), _node(node) {
+    _mgr->ref(_node);
+}
+
+inline BDD::BDD(const BDD& other) : _mgr(other._mgr), _node(other._node) {
+    if (_mgr != nullptr) {
+        _mgr->ref(_node);
+    }
+}
+
+inline BDD& BDD::operator=(const BDD& other) {
+    if (other._mgr != nullptr) {
+        other._mgr->ref(other._node);
+    }
+    if (_mgr != nullptr) {
+        _mgr->deref(_node);
+    }
+    _mgr = other._mgr;
+    _node = other._node;
+    return *this;
+}
+
+inline BDD::~BDD() {
+    if (_mgr != nullptr) {
+        _mgr->deref(_node);
+    }
+}
+
+inline BDD BDD::operator&(const BDD& other) const {
+    return _mgr->apply_and(*this, other);
+}
+
+inline BDD BDD::operator|(const BDD& other) const {
+    return _mgr->apply_or(*this, other);
+}
+
+inline BDD BDD::operator!() const { return _mgr->apply_not(*this); }
@@ -1,254 +1,1165 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <queue>
+#include <stdexcept>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "formula.h"
+#include "formula_table.h"
 #include "graph.h"
 #include "kripke.h"
+#include "parallel_scc.h"
+#include "plan.h"
+#include "profiler.h"
+#include "stateset.h"
+#include "symbolic.h"
+#include "threadpool.h"
 
-void _checkNot(Kripke &kripke, std::shared_ptr<Formula> formula,
-               std::unordered_map<std::string, std::unordered_set<int>> &L);
-void _checkOr(Kripke &kripke, std::shared_ptr<Formula> formula,
-              std::unordered_map<std::string, std::unordered_set<int>> &L);
-void _checkAP(Kripke &kripke, std::shared_ptr<Formula> formula,
-              std::unordered_map<std::string, std::unordered_set<int>> &L);
-void _checkEG(Kripke &kripke, std::shared_ptr<Formula> formula,
-              std::unordered_map<std::string, std::unordered_set<int>> &L);
-void _checkEU(Kripke &kripke, std::shared_ptr<Formula> formula,
-              std::unordered_map<std::string, std::unordered_set<int>> &L);
-void _checkEX(Kripke &kripke, std::shared_ptr<Formula> formula,
-              std::unordered_map<std::string, std::unordered_set<int>> &L);
-void _checkStateFormula(
-    Kripke &kripke, std::shared_ptr<Formula> formula,
-    std::unordered_map<std::string, std::unordered_set<int>> &L);
-
-inline void modelcheck(
-    Kripke &kripke, std::shared_ptr<Formula> formula,
-    std::unordered_map<std::string, std::unordered_set<int>> &L,
-    std::vector<std::unordered_set<int>> &F) {
-    if (F.size() != 0) {
-        std::string fair_label = kripke.label_fair_states(F);
-        formula = formula->get_equivalent_non_fair_formula(
-            std::make_shared<CTL::AtomicProposition>(fair_label));
-    }
-
-    return _checkStateFormula(kripke, formula, L);
-}
-
-inline void _checkStateFormula(
-    Kripke &kripke, std::shared_ptr<Formula> formula,
-    std::unordered_map<std::string, std::unordered_set<int>> &L) {
-    switch (formula->opcode) {
-        case (OpCode::Not): {
-            return _checkNot(kripke, formula, L);
-        }
-        case (OpCode::Or): {
-            return _checkOr(kripke, formula, L);
-        }
-        case (OpCode::Bool): {
-            if (formula->str() == "true") {
-                std::vector<int> _Lformula;
-                kripke.states(_Lformula);
-                std::unordered_set<int> Lformula(_Lformula.begin(),
-                                                 _Lformula.end());
-                L["true"] = Lformula;
-            } else {
-                L["false"] = {};
+typedef enum { Explicit, Symbolic } CheckEngine;
+
+// With num_threads != 1 (0 meaning one per hardware thread), or a `pool`,
+// independent subformulas are evaluated concurrently. The Symbolic engine
+// evaluates formulas by BDD fixpoints on a SymbolicKripke instead, and
+// stores only the result of the checked formula itself; it runs on the
+// calling thread, ignoring the thread, pool, SCC and free_dead_results
+// options, records each check as one "symbolic" phase of the profiler, and
+// rejects `witnesses` and a `memory_budget`. With `witnesses`,
+// the Explicit engine records for EU and EG how each state entered the
+// fixpoint, from which witness() and counterexample() build traces. With a
+// `profiler`, the Explicit engine records every subformula it evaluates and
+// the SCC and fairness phases. A nonzero `memory_budget` (in bytes) bounds
+// the model plus the Labelling: before each step, the Explicit engine evicts
+// results that the running check no longer reads, including those of
+// earlier checks, and throws MemoryBudgetExceeded if the step still does
+// not fit. With `free_dead_results`, a check keeps only the results of its
+// roots (all formulas of a batch) and of pinned ids: every other result it
+// computes is released as soon as the last step reading it has finished.
+struct CheckOptions {
+    CheckEngine engine = CheckEngine::Explicit;
+    SCCOptions scc;
+    int num_threads = 1;
+    ThreadPool *pool = nullptr;
+    bool witnesses = false;
+    Profiler *profiler = nullptr;
+    std::size_t memory_budget = 0;
+    bool free_dead_results = false;
+};
+
+// Thrown when a step of a check does not fit in CheckOptions::memory_budget
+// even after evicting every result that could be recomputed. All sizes are
+// in bytes; `step` is the estimated peak of the step, `evicted` what was
+// freed trying to make room for it.
+class MemoryBudgetExceeded : public std::runtime_error {
+   public:
+    MemoryBudgetExceeded(const std::string &formula, std::size_t budget,
+                         std::size_t model, std::size_t results,
+                         std::size_t step, std::size_t evicted)
+        : std::runtime_error(
+              "Memory budget of " + std::to_string(budget) +
+              " bytes exceeded checking " + formula + ": the model holds " +
+              std::to_string(model) + ", live results " +
+              std::to_string(results) + " (after evicting " +
+              std::to_string(evicted) + "), and the step needs about " +
+              std::to_string(step)),
+          formula(formula),
+          budget(budget),
+          model(model),
+          results(results),
+          step(step),
+          evicted(evicted) {}
+
+    std::string formula;
+    std::size_t budget;
+    std::size_t model;
+    std::size_t results;
+    std::size_t step;
+    std::size_t evicted;
+};
+
+// Cycles recorded by a fair EG check with witnesses, one per fair SCC of
+// its result: the cycle of the SCC whose entry state is entries[i] is
+// states[offsets[i]..offsets[i + 1]), which starts at that entry, visits
+// every fairness set and continues at the entry again. Entries are sorted.
+struct FairCycles {
+    std::vector<int> entries;
+    std::vector<std::size_t> offsets{0};
+    std::vector<int> states;
+
+    IndexRange cycle(int entry) const {
+        auto found = std::lower_bound(entries.begin(), entries.end(), entry);
+        if (found == entries.end() || *found != entry) {
+            return IndexRange(nullptr, nullptr);
+        }
+        std::size_t i = found - entries.begin();
+        return IndexRange(states.data() + offsets[i],
+                          states.data() + offsets[i + 1]);
+    }
+
+    std::size_t bytes() const {
+        return entries.capacity() * sizeof(int) +
+               offsets.capacity() * sizeof(std::size_t) +
+               states.capacity() * sizeof(int);
+    }
+};
+
+// Satisfaction sets of interned subformulas, indexed by formula id. Sets
+// range over the dense state indices of kripke.csr(); use kripke.csr().id(i)
+// to recover the state of index i. Different ids may be set concurrently
+// once slots for them have been reserved. A Labelling is only valid for the
+// Kripke structure and fairness constraints it was filled for.
+class Labelling {
+   public:
+    FormulaTable formulas;
+    CheckOptions options;
+    // Fairness constraints as sets of dense indices, and the states from
+    // which a fair path starts. Under fairness, path quantifiers range over
+    // fair paths only: those visiting every set infinitely often.
+    std::vector<StateSet> fairness;
+    StateSet fair;
+
+    bool contains(int id) const {
+        return id < int(_computed.size()) &&
+               _computed[id].load(std::memory_order_acquire);
+    }
+
+    const StateSet &operator[](int id) const { return *_views[id]; }
+
+    const StateSet &at(int id) const {
+        if (!contains(id)) {
+            throw std::runtime_error(formulas.str(id) +
+                                     " has not been checked");
+        }
+        return *_views[id];
+    }
+
+    void reserve(int n) {
+        if (n > int(_sets.size())) {
+            _sets.resize(n);
+            _views.resize(n, nullptr);
+            _computed.resize(n);
+            _next.resize(n);
+            _cycles.resize(n);
+            _aliases.resize(n);
+            _owners.resize(n, -1);
+            _pinned.resize(n, 0);
+        }
+    }
+
+    void set(int id, StateSet S) {
+        reserve(id + 1);
+        _bytes += S.bytes();
+        _bytes -= _sets[id].bytes();
+        _sets[id] = std::move(S);
+        _views[id] = &_sets[id];
+        _owners[id] = -1;
+        _computed[id].store(1, std::memory_order_release);
+    }
+
+    // Makes L[id] the result of `target`, which must have been checked.
+    void alias(int id, int target) {
+        reserve(std::max(id, target) + 1);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::vector<int> &aliases = _aliases[target];
+            if (std::find(aliases.begin(), aliases.end(), id) ==
+                aliases.end()) {
+                aliases.push_back(id);
             }
-            return;
         }
-        case (OpCode::Atomic): {
-            return _checkAP(kripke, formula, L);
+        _owners[id] = target;
+        _views[id] = _views[target];
+        _computed[id].store(1, std::memory_order_release);
+    }
+
+    // The id whose result L[id] shares, or id itself.
+    int alias_of(int id) const {
+        return id < int(_owners.size()) && _owners[id] != -1 ? _owners[id]
+                                                             : id;
+    }
+
+    // Pinned results are never released to free memory. Not safe during a
+    // check.
+    void pin(int id) {
+        reserve(id + 1);
+        _pinned[id] = 1;
+    }
+
+    void unpin(int id) {
+        reserve(id + 1);
+        _pinned[id] = 0;
+    }
+
+    bool pinned(int id) const {
+        return id < int(_pinned.size()) && _pinned[id];
+    }
+
+    // Makes L[id] refer to S without copying it; S must outlive the
+    // labelling, or at least every later read of id.
+    void borrow(int id, const StateSet &S) {
+        reserve(id + 1);
+        _views[id] = &S;
+        _owners[id] = -1;
+        _computed[id].store(1, std::memory_order_release);
+    }
+
+    // For a checked EU or EG formula, the successor through which each state
+    // entered its fixpoint (-1 where the path ends); empty unless recorded.
+    const std::vector<int> &next(int id) const { return _next[id]; }
+
+    // Must be called before set(id, ...).
+    void set_next(int id, std::vector<int> next) {
+        reserve(id + 1);
+        _bytes += next.capacity() * sizeof(int);
+        _bytes -= _next[id].capacity() * sizeof(int);
+        _next[id] = std::move(next);
+    }
+
+    // For a checked fair EG formula, the cycles its witnesses end in; next
+    // then leads every state of the result to the entry of one of them,
+    // where it is -1.
+    const FairCycles &cycles(int id) const { return _cycles[id]; }
+
+    // Must be called before set(id, ...).
+    void set_cycles(int id, FairCycles cycles) {
+        reserve(id + 1);
+        _bytes += cycles.bytes();
+        _bytes -= _cycles[id].bytes();
+        _cycles[id] = std::move(cycles);
+    }
+
+    // Heap bytes of the results and traces L owns (not of those borrowed
+    // from the model) and of the fairness sets.
+    std::size_t bytes() const {
+        std::size_t total = _bytes + fair.bytes();
+        for (const StateSet &S : fairness) {
+            total += S.bytes();
+        }
+        return total;
+    }
+
+    // Bytes held for id alone, or 0 if it is borrowed or unchecked.
+    std::size_t owned_bytes(int id) const {
+        if (!contains(id) || _views[id] != &_sets[id]) {
+            return 0;
         }
-        case (OpCode::E): {
-            switch (formula->subformulas[0]->opcode) {
-                case (OpCode::G): {
-                    return _checkEG(kripke, formula, L);
-                }
-                case (OpCode::U): {
-                    return _checkEU(kripke, formula, L);
-                }
-                case (OpCode::X): {
-                    return _checkEX(kripke, formula, L);
-                }
+        return _sets[id].bytes() + _next[id].capacity() * sizeof(int) +
+               _cycles[id].bytes();
+    }
+
+    // The SCC options for decompositions during checks and traces. A
+    // ForwardBackward engine without a pool of its own runs on the pool of
+    // the running parallel check, and otherwise on a pool of
+    // options.scc.num_threads threads that L builds on first use and keeps.
+    SCCOptions scc_options() const {
+        SCCOptions scc = options.scc;
+        if (scc.algorithm != SCCAlgorithm::ForwardBackward ||
+            scc.pool != nullptr) {
+            return scc;
+        }
+        if (_check_pool != nullptr) {
+            scc.pool = _check_pool;
+            return scc;
+        }
+        std::lock_guard<std::mutex> lock(_scc_mutex);
+        if (!_scc_pool) {
+            _scc_pool.reset(new ThreadPool(scc.num_threads));
+        }
+        scc.pool = _scc_pool.get();
+        return scc;
+    }
+
+    // The checker of the Symbolic engine, built on first use and kept for
+    // later checks as long as the structure, its CSR form and F stay the
+    // same; it shares the formula table of L.
+    SymbolicChecker &symbolic(const Kripke &kripke,
+                              const std::vector<std::unordered_set<int>> &F) {
+        if (!_symbolic || _symbolic_kripke != &kripke ||
+            _symbolic_graph != &kripke.csr() || _symbolic_fairness != F) {
+            _symbolic.reset(new SymbolicChecker(kripke, formulas, F));
+            _symbolic_kripke = &kripke;
+            _symbolic_graph = &kripke.csr();
+            _symbolic_fairness = F;
+        }
+        return *_symbolic;
+    }
+
+    // Drops the result of id and of its aliases, which count as unchecked
+    // again. Nothing may read them concurrently.
+    void evict(int id) {
+        std::vector<int> aliases;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            aliases.swap(_aliases[id]);
+        }
+        for (int a : aliases) {
+            if (_owners[a] == id) {
+                _computed[a].store(0, std::memory_order_release);
+                _views[a] = nullptr;
+                _owners[a] = -1;
             }
         }
+        _bytes -= owned_bytes(id);
+        _computed[id].store(0, std::memory_order_release);
+        _views[id] = nullptr;
+        _sets[id] = StateSet();
+        _next[id] = std::vector<int>();
+        _cycles[id] = FairCycles();
     }
 
-    std::shared_ptr<Formula> restr_f =
-        formula->get_equivalent_restricted_formula();
-    _checkStateFormula(kripke, restr_f, L);
-}
+   private:
+    // Deques keep references to computed sets valid while new subformulas
+    // are added.
+    std::deque<StateSet> _sets;
+    std::deque<const StateSet *> _views;
+    std::deque<std::atomic<char>> _computed;
+    std::deque<std::vector<int>> _next;
+    std::deque<FairCycles> _cycles;
+    // The ids aliasing each id, guarded by _mutex, and the reverse map.
+    std::deque<std::vector<int>> _aliases;
+    std::deque<int> _owners;
+    std::deque<char> _pinned;
+    std::mutex _mutex;
+    std::atomic<std::size_t> _bytes{0};
+    // The pool of the running parallel check, and the pool L keeps for SCC
+    // decompositions outside of one.
+    ThreadPool *_check_pool = nullptr;
+    mutable std::unique_ptr<ThreadPool> _scc_pool;
+    mutable std::mutex _scc_mutex;
+    // The Symbolic engine's checker and what it was built for.
+    std::unique_ptr<SymbolicChecker> _symbolic;
+    const Kripke *_symbolic_kripke = nullptr;
+    const CSRGraph *_symbolic_graph = nullptr;
+    std::vector<std::unordered_set<int>> _symbolic_fairness;
 
-inline void _checkAP(
-    Kripke &kripke, std::shared_ptr<Formula> formula,
-    std::unordered_map<std::string, std::unordered_set<int>> &L) {
-    std::string s = formula->str();
-    if (L.find(s) == L.end()) {
-        std::unordered_set<int> Lformula;
-        L.emplace(s, Lformula);
+    friend void _executeParallel(Kripke &kripke, const EvaluationPlan &plan,
+                                 Labelling &L, ThreadPool &pool);
+};
 
-        std::vector<int> states;
-        kripke.states(states);
+void _checkAP(Kripke &kripke, int id, Labelling &L);
+void _checkEG(Kripke &kripke, int id, Labelling &L);
+void _checkEU(Kripke &kripke, int id, Labelling &L);
+void _checkEX(Kripke &kripke, int id, Labelling &L);
+void _checkStateFormula(Kripke &kripke, int id, Labelling &L);
+StateSet _EX(Kripke &kripke, const StateSet &in_phi, Labelling &L,
+             StepStats *stats = nullptr);
+StateSet _EU(Kripke &kripke, const StateSet &in_phi, const StateSet &in_psi,
+             Labelling &L, std::vector<int> *next, StepStats *stats = nullptr);
+StateSet _EG(Kripke &kripke, const StateSet &in_phi, Labelling &L,
+             std::vector<int> *next, StepStats *stats = nullptr,
+             FairCycles *cycles = nullptr);
+void _setFairness(Kripke &kripke,
+                  const std::vector<std::unordered_set<int>> &F, Labelling &L);
+void _checkStateFormulas(Kripke &kripke, const std::vector<int> &roots,
+                         Labelling &L);
+void _execute(Kripke &kripke, const EvaluationPlan &plan, Labelling &L);
+const Condensation &_condensation(Kripke &kripke, Labelling &L);
+void _executeParallel(Kripke &kripke, const EvaluationPlan &plan,
+                      Labelling &L, ThreadPool &pool);
 
-        for (int v : states) {
-            std::unordered_set<std::string> tmp_l = kripke.labels(v);
-            if (tmp_l.find(s) != tmp_l.end()) {
-                L[s].insert(v);
+// Checks `formula` and returns the id of the formula whose satisfaction set
+// L[id] holds the result.
+inline int modelcheck(Kripke &kripke, std::shared_ptr<Formula> formula,
+                      Labelling &L, std::vector<std::unordered_set<int>> &F) {
+    if (L.options.engine == CheckEngine::Symbolic) {
+        if (L.options.witnesses || L.options.memory_budget != 0) {
+            throw std::runtime_error(
+                "The Symbolic engine supports neither witnesses nor a "
+                "memory budget");
+        }
+        int id = L.formulas.intern(formula);
+        if (!L.contains(id)) {
+            std::unique_ptr<Profiler::Phase> phase;
+            if (L.options.profiler != nullptr) {
+                phase.reset(new Profiler::Phase(*L.options.profiler,
+                                                "symbolic"));
             }
+            SymbolicChecker &checker = L.symbolic(kripke, F);
+            L.set(id, checker.model().decode(checker.check(id)));
         }
+        return id;
+    }
+
+    if (F.size() != 0 && L.fairness.empty()) {
+        _setFairness(kripke, F, L);
     }
+
+    int id = L.formulas.intern(formula);
+    _checkStateFormulas(kripke, {id}, L);
+    return id;
 }
 
-inline void _checkNot(
-    Kripke &kripke, std::shared_ptr<Formula> formula,
-    std::unordered_map<std::string, std::unordered_set<int>> &L) {
-    std::string s = formula->str();
-    if (L.find(s) == L.end()) {
-        std::unordered_set<int> Lformula;
-        L.emplace(s, Lformula);
+// Checks the interned formulas `roots`, evaluating subformulas they share
+// only once.
+inline void _checkStateFormulas(Kripke &kripke, const std::vector<int> &roots,
+                                Labelling &L) {
+    EvaluationPlan plan = compile_plan(L.formulas, roots);
+    if (L.options.pool != nullptr) {
+        _executeParallel(kripke, plan, L, *L.options.pool);
+    } else if (L.options.num_threads != 1) {
+        ThreadPool pool(L.options.num_threads);
+        _executeParallel(kripke, plan, L, pool);
+    } else {
+        _execute(kripke, plan, L);
+    }
+}
 
-        std::string s_phi = formula->subformulas[0]->str();
-        _checkStateFormula(kripke, formula->subformulas[0], L);
+inline void _checkStateFormula(Kripke &kripke, int id, Labelling &L) {
+    if (!L.contains(id)) {
+        _execute(kripke, compile_plan(L.formulas, {id}), L);
+    }
+}
 
-        std::vector<int> states;
-        kripke.states(states);
+// Computes the slot of one step, adding the work done to `stats` if given.
+inline void _runStep(Kripke &kripke, const PlanStep &step, Labelling &L,
+                     StepStats *stats) {
+    int id = step.slot;
+    switch (step.op) {
+        case (PlanOp::Bool): {
+            return L.set(id, StateSet(kripke.csr().size(), step.left));
+        }
+        case (PlanOp::Atomic): {
+            return _checkAP(kripke, id, L);
+        }
+        case (PlanOp::Not): {
+            if (stats != nullptr) {
+                stats->states += L[step.left].size();
+            }
+            return L.set(id, ~L[step.left]);
+        }
+        case (PlanOp::Or): {
+            if (stats != nullptr) {
+                stats->states += L[step.left].size();
+            }
+            return L.set(id, L[step.left] | L[step.right]);
+        }
+        case (PlanOp::EX): {
+            return L.set(id, _EX(kripke, L[step.left], L, stats));
+        }
+        case (PlanOp::EU):
+        case (PlanOp::EG): {
+            std::vector<int> next;
+            FairCycles cycles;
+            std::vector<int> *witness = L.options.witnesses ? &next : nullptr;
+            StateSet S = step.op == PlanOp::EU
+                             ? _EU(kripke, L[step.left], L[step.right], L,
+                                   witness, stats)
+                             : _EG(kripke, L[step.left], L, witness, stats,
+                                   &cycles);
+            if (witness != nullptr) {
+                L.set_next(id, std::move(next));
+                L.set_cycles(id, std::move(cycles));
+            }
+            return L.set(id, std::move(S));
+        }
+        case (PlanOp::Alias): {
+            return L.alias(id, step.left);
+        }
+    }
+}
 
-        for (int v : states) {
-            if (L[s_phi].find(v) == L[s_phi].end()) {
-                L[s].insert(v);
+// Runs one step of a plan, unless L already holds its slot.
+inline void _executeStep(Kripke &kripke, const PlanStep &step, Labelling &L) {
+    int id = step.slot;
+    if (L.contains(id)) {
+        return;
+    }
+    Profiler *profiler = L.options.profiler;
+    if (profiler == nullptr) {
+        return _runStep(kripke, step, L, nullptr);
+    }
+    StepStats stats;
+    double start = profiler->now();
+    _runStep(kripke, step, L, &stats);
+    double duration = profiler->now() - start;
+    profiler->record(Profiler::Event{L.formulas.str(id),
+                                     plan_op_name(step.op), id, start,
+                                     duration, 0, stats,
+                                     long(L[id].count())});
+}
+
+// Marks the steps of `plan` that must run: those computing a slot that L
+// lacks for a root, directly or through other such steps. Results that
+// were released are thus only recomputed where they are read.
+inline std::vector<char> _pendingSteps(const EvaluationPlan &plan,
+                                       const Labelling &L) {
+    std::vector<char> needed(L.formulas.size(), 0);
+    for (int root : plan.roots) {
+        needed[root] = 1;
+    }
+    std::vector<char> pending(plan.steps.size(), 0);
+    for (int i = int(plan.steps.size()) - 1; i >= 0; i--) {
+        const PlanStep &step = plan.steps[i];
+        if (needed[step.slot] && !L.contains(step.slot)) {
+            pending[i] = 1;
+            int operands[] = {step.left, step.right};
+            for (int k = 0; k < step.arity(); k++) {
+                needed[operands[k]] = 1;
             }
         }
     }
+    return pending;
 }
 
-inline void _checkOr(
-    Kripke &kripke, std::shared_ptr<Formula> formula,
-    std::unordered_map<std::string, std::unordered_set<int>> &L) {
-    std::string s = formula->str();
+// Tracks the results of a running plan for L.options.memory_budget and
+// free_dead_results; inactive without either. A result stays live while a
+// root, a pinned id or an unfinished step reads it, directly or through an
+// alias. Before a step, the largest results that are not live are evicted
+// until the model, L, the steps in flight and the estimated peak of the
+// step fit in the budget. With free_dead_results, the results the plan
+// computes are evicted as soon as they are no longer live.
+class _LiveResults {
+   public:
+    _LiveResults(Kripke &kripke, const EvaluationPlan &plan,
+                 const std::vector<char> &pending, Labelling &L)
+        : _kripke(kripke),
+          _L(L),
+          _budget(L.options.memory_budget),
+          _free(L.options.free_dead_results) {
+        if (_budget == 0 && !_free) {
+            return;
+        }
+        kripke.csr();
+        kripke.predecessors();
+        _model = kripke.bytes();
+        _target.assign(L.formulas.size(), -1);
+        _readers.assign(L.formulas.size(), 0);
+        _computes.assign(L.formulas.size(), 0);
+        for (const PlanStep &step : plan.steps) {
+            if (step.op == PlanOp::Alias) {
+                _target[step.slot] = step.left;
+            }
+        }
+        for (int root : plan.roots) {
+            _readers[_resolve(root)]++;
+        }
+        for (int id = 0; id < L.formulas.size(); id++) {
+            if (L.pinned(id)) {
+                _readers[_resolve(id)]++;
+            }
+        }
+        for (std::size_t i = 0; i < plan.steps.size(); i++) {
+            if (pending[i]) {
+                _computes[plan.steps[i].slot] = 1;
+                _read(plan.steps[i], 1);
+            }
+        }
+    }
+
+    // Makes room for `step`, or throws MemoryBudgetExceeded.
+    void start(const PlanStep &step) {
+        if (_budget == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::size_t need = _estimate(step);
+        std::size_t evicted = 0;
+        while (_model + _L.bytes() + _running + need > _budget) {
+            int victim = -1;
+            std::size_t largest = 0;
+            for (int id = 0; id < int(_readers.size()); id++) {
+                std::size_t bytes = _L.owned_bytes(id);
+                if (_readers[id] == 0 && bytes > largest) {
+                    victim = id;
+                    largest = bytes;
+                }
+            }
+            if (victim == -1) {
+                throw MemoryBudgetExceeded(_L.formulas.str(step.slot),
+                                           _budget, _model, _L.bytes(),
+                                           _running + need, evicted);
+            }
+            _L.evict(victim);
+            evicted += largest;
+        }
+        _running += need;
+    }
+
+    // Releases the operands of a finished `step`.
+    void finish(const PlanStep &step) {
+        if (_budget == 0 && !_free) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_budget != 0) {
+            _running -= _estimate(step);
+        }
+        _read(step, -1);
+        if (_free) {
+            int operands[] = {step.left, step.right};
+            for (int k = 0; k < step.arity(); k++) {
+                int id = _resolve(operands[k]);
+                if (_readers[id] == 0 && _computes[id] && _L.contains(id)) {
+                    _L.evict(id);
+                }
+            }
+        }
+        if (step.op == PlanOp::EG) {
+            _model = _kripke.bytes();
+        }
+    }
+
+   private:
+    Kripke &_kripke;
+    Labelling &_L;
+    std::size_t _budget;
+    bool _free;
+    std::size_t _model = 0;
+    std::size_t _running = 0;
+    // The slot each Alias slot of the plan shares, or -1.
+    std::vector<int> _target;
+    // Roots, pinned ids and unfinished steps reading each slot.
+    std::vector<int> _readers;
+    // Whether the plan computes each slot.
+    std::vector<char> _computes;
+    std::mutex _mutex;
+
+    int _resolve(int id) const {
+        return _target[id] == -1 ? _L.alias_of(id) : _target[id];
+    }
 
-    if (L.find(s) == L.end()) {
-        std::unordered_set<int> Lformula;
-        L.emplace(s, Lformula);
+    void _read(const PlanStep &step, int delta) {
+        int operands[] = {step.left, step.right};
+        for (int k = 0; k < step.arity(); k++) {
+            _readers[_resolve(operands[k])] += delta;
+        }
+    }
 
-        for (std::shared_ptr<Formula> sf : formula->subformulas) {
-            _checkStateFormula(kripke, sf, L);
-            std::string sf_str = sf->str();
-            for (int v : L[sf_str]) {
-                L[s].insert(v);
+    // Approximate peak bytes of a step: its result, the queues of EU and EG,
+    // the local SCCs of EG and the SCC cache if EG builds it first.
+    std::size_t _estimate(const PlanStep &step) const {
+        std::size_t n = _kripke.csr().size();
+        std::size_t result = (n + 63) / 64 * sizeof(std::uint64_t);
+        std::size_t next = _L.options.witnesses ? n * sizeof(int) : 0;
+        switch (step.op) {
+            case (PlanOp::Alias): {
+                return 0;
+            }
+            case (PlanOp::EU): {
+                return result + n * sizeof(int) + next;
+            }
+            case (PlanOp::EG): {
+                std::size_t scc = 4 * n * sizeof(int) + next;
+                if (!_kripke.has_condensation()) {
+                    scc += 6 * n * sizeof(int) +
+                           _kripke.csr().num_edges() * sizeof(int);
+                }
+                return result + scc;
+            }
+            default: {
+                return result;
             }
         }
     }
-}
+};
 
-inline void _checkEX(
-    Kripke &kripke, std::shared_ptr<Formula> formula,
-    std::unordered_map<std::string, std::unordered_set<int>> &L) {
-    std::string s = formula->str();
+// Runs the steps of `plan` in order.
+inline void _execute(Kripke &kripke, const EvaluationPlan &plan,
+                     Labelling &L) {
+    L.reserve(L.formulas.size());
+    std::vector<char> pending = _pendingSteps(plan, L);
+    _LiveResults live(kripke, plan, pending, L);
+    for (std::size_t i = 0; i < plan.steps.size(); i++) {
+        if (pending[i]) {
+            live.start(plan.steps[i]);
+            _executeStep(kripke, plan.steps[i], L);
+            live.finish(plan.steps[i]);
+        }
+    }
+}
 
-    if (L.find(s) == L.end()) {
-        std::unordered_set<int> Lformula;
-        L.emplace(s, Lformula);
+// Runs the steps of `plan` on `pool`. The model's CSR and SCC caches are
+// built up front; afterwards a step is scheduled as soon as the last of its
+// operands has been computed, so independent subformulas run concurrently.
+inline void _executeParallel(Kripke &kripke, const EvaluationPlan &plan,
+                             Labelling &L, ThreadPool &pool) {
+    // SCC decompositions of the steps run on the pool of the check.
+    struct PoolScope {
+        Labelling &L;
+        ThreadPool *saved;
+        ~PoolScope() { L._check_pool = saved; }
+    } scope{L, L._check_pool};
+    L._check_pool = &pool;
 
-        std::shared_ptr<Formula> target_formula =
-            formula->subformulas[0]->subformulas[0];
-        _checkStateFormula(kripke, target_formula, L);
-        std::string t_str = target_formula->str();
+    kripke.csr();
+    kripke.predecessors();
+    _condensation(kripke, L);
+    L.reserve(L.formulas.size());
 
-        std::vector<std::pair<int, int>> transitions;
-        kripke.transitions(transitions);
+    const std::vector<PlanStep> &steps = plan.steps;
+    const int n = steps.size();
+    std::vector<int> position(L.formulas.size(), -1);
+    std::vector<std::vector<int>> dependents(n);
+    std::vector<std::atomic<int>> missing(n);
+    std::vector<int> ready;
+    std::vector<char> pending = _pendingSteps(plan, L);
+    for (int i = 0; i < n; i++) {
+        const PlanStep &step = steps[i];
+        position[step.slot] = i;
+        if (!pending[i]) {
+            continue;
+        }
+        int operands[] = {step.left, step.right};
+        int count = 0;
+        for (int k = 0; k < step.arity(); k++) {
+            if (!L.contains(operands[k])) {
+                dependents[position[operands[k]]].push_back(i);
+                count++;
+            }
+        }
+        missing[i].store(count, std::memory_order_relaxed);
+        if (count == 0) {
+            ready.push_back(i);
+        }
+    }
 
-        for (std::pair<int, int> e : transitions) {
-            if (L[t_str].find(e.second) != L[t_str].end()) {
-                L[s].insert(e.first);
+    _LiveResults live(kripke, plan, pending, L);
+    TaskGroup group(pool);
+    std::function<void(int)> evaluate = [&](int i) {
+        live.start(steps[i]);
+        _executeStep(kripke, steps[i], L);
+        live.finish(steps[i]);
+        for (int p : dependents[i]) {
+            if (missing[p].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                group.run([&evaluate, p] { evaluate(p); });
             }
         }
+    };
+    for (int i : ready) {
+        group.run([&evaluate, i] { evaluate(i); });
     }
+    group.wait();
 }
 
-inline void _checkEU(
-    Kripke &kripke, std::shared_ptr<Formula> formula,
-    std::unordered_map<std::string, std::unordered_set<int>> &L) {
-    std::string s = formula->str();
+inline void _checkAP(Kripke &kripke, int id, Labelling &L) {
+    const std::string &s = L.formulas.ap_name(L.formulas.node(id).ap);
+    const StateSet *S = kripke.ap_states(s);
+    if (S != nullptr && !L.fairness.empty()) {
+        L.set(id, *S & L.fair);
+    } else if (S != nullptr) {
+        L.borrow(id, *S);
+    } else {
+        L.set(id, StateSet(kripke.csr().size()));
+    }
+}
 
-    if (L.find(s) == L.end()) {
-        std::unordered_set<int> Lformula;
-        L.emplace(s, Lformula);
+// Counts the layers, states and edges of a breadth-first pass over a queue,
+// and adds them to `stats` (if given) when the pass ends.
+class _StepCounter {
+   public:
+    explicit _StepCounter(StepStats *stats) : _stats(stats) {}
 
-        std::shared_ptr<Formula> psi = formula->subformulas[0]->subformulas[0];
-        std::shared_ptr<Formula> chi = formula->subformulas[0]->subformulas[1];
-        std::string psi_str = psi->str();
-        std::string chi_str = chi->str();
+    ~_StepCounter() {
+        if (_stats != nullptr) {
+            _stats->iterations += _layers;
+            _stats->states += _states;
+            _stats->edges += _edges;
+        }
+    }
+
+    // Called for queue[i] of a queue of `size` entries with `edges` edges.
+    void visit(std::size_t i, std::size_t size, std::size_t edges) {
+        if (i == _layer_end) {
+            _layers++;
+            _layer_end = size;
+        }
+        _states++;
+        _edges += edges;
+    }
 
-        _checkStateFormula(kripke, psi, L);
-        _checkStateFormula(kripke, chi, L);
+   private:
+    StepStats *_stats;
+    std::size_t _layer_end = 0;
+    long _layers = 0;
+    long _states = 0;
+    long _edges = 0;
+};
 
-        std::unordered_set<int> T = L[chi_str];
-        L[s] = L[chi_str];
+// Builds the SCC cache of `kripke`, timed as a phase when profiling.
+inline const Condensation &_condensation(Kripke &kripke, Labelling &L) {
+    if (L.options.profiler != nullptr && !kripke.has_condensation()) {
+        Profiler::Phase phase = L.options.profiler->phase("scc");
+        return kripke.condensation(L.scc_options());
+    }
+    return kripke.condensation(L.scc_options());
+}
+
+// EX phi: the predecessors of phi-states (of fair ones, under fairness).
+inline StateSet _EX(Kripke &kripke, const StateSet &in_phi, Labelling &L,
+                    StepStats *stats) {
+    const CSRGraph &pre = kripke.predecessors();
+    StateSet Lformula(pre.size());
+
+    const bool fairness = !L.fairness.empty();
+    long states = 0;
+    long edges = 0;
+    in_phi.for_each([&](int w) {
+        if (fairness && !L.fair.contains(w)) {
+            return;
+        }
+        IndexRange sources = pre.successors(w);
+        states++;
+        edges += sources.size();
+        for (int v : sources) {
+            Lformula.insert(v);
+        }
+    });
+    if (stats != nullptr) {
+        stats->iterations++;
+        stats->states += states;
+        stats->edges += edges;
+    }
+    return Lformula;
+}
 
-        std::vector<std::pair<int, int>> transitions;
-        kripke.transitions(transitions);
+inline void _checkEX(Kripke &kripke, int id, Labelling &L) {
+    int phi = L.formulas.node(L.formulas.node(id).left).left;
+    _checkStateFormula(kripke, phi, L);
+    L.set(id, _EX(kripke, L[phi], L));
+}
 
-        while (!T.empty()) {
-            int v = *T.begin();
-            T.erase(T.begin());
+// E[phi U psi], with psi restricted to fair states under fairness. If
+// `next` is given, it receives for each state the successor through which
+// it entered the result.
+inline StateSet _EU(Kripke &kripke, const StateSet &in_phi,
+                    const StateSet &in_psi, Labelling &L,
+                    std::vector<int> *next, StepStats *stats) {
+    const CSRGraph &pre = kripke.predecessors();
+    StateSet Lformula = in_psi;
+    if (!L.fairness.empty()) {
+        Lformula &= L.fair;
+    }
+    std::vector<int> T;
+    Lformula.to_vector(T);
+    if (next != nullptr) {
+        next->assign(pre.size(), -1);
+    }
 
-            for (std::pair<int, int> e : transitions) {
-                if (e.second == v) {
-                    int t = e.first;
-                    if (L[s].find(t) == L[s].end() &&
-                        L[psi_str].find(t) == L[psi_str].end()) {
-                        L[s].insert(t);
-                        T.insert(t);
-                    }
+    // Breadth-first, so that next leads along shortest paths to psi.
+    _StepCounter counter(stats);
+    for (std::size_t i = 0; i < T.size(); i++) {
+        int v = T[i];
+        IndexRange sources = pre.successors(v);
+        counter.visit(i, T.size(), sources.size());
+        for (int t : sources) {
+            if (in_phi.contains(t) && Lformula.test_and_insert(t)) {
+                T.push_back(t);
+                if (next != nullptr) {
+                    (*next)[t] = v;
                 }
             }
         }
     }
+    return Lformula;
 }
 
-inline void _checkEG(
-    Kripke &kripke, std::shared_ptr<Formula> formula,
-    std::unordered_map<std::string, std::unordered_set<int>> &L) {
-    std::string s = formula->str();
+inline void _checkEU(Kripke &kripke, int id, Labelling &L) {
+    const FormulaNode &path = L.formulas.node(L.formulas.node(id).left);
+    int phi = path.left;
+    int psi = path.right;
+    _checkStateFormula(kripke, phi, L);
+    _checkStateFormula(kripke, psi, L);
 
-    if (L.find(s) == L.end()) {
-        std::unordered_set<int> Lformula;
-        L.emplace(s, Lformula);
+    if (L.options.witnesses) {
+        std::vector<int> next;
+        StateSet Lformula = _EU(kripke, L[phi], L[psi], L, &next);
+        L.set_next(id, std::move(next));
+        L.set(id, std::move(Lformula));
+    } else {
+        L.set(id, _EU(kripke, L[phi], L[psi], L, nullptr));
+    }
+}
 
-        std::shared_ptr<Formula> phi = formula->subformulas[0]->subformulas[0];
-        _checkStateFormula(kripke, phi, L);
+// Appends to `result` the SCCs of the subgraph induced by Z that contain a
+// cycle. They refine the cached SCCs of the whole structure: a cyclic
+// component lying inside Z is one of them, so only components that Z cuts
+// are decomposed again, into `local`, timed as an SCC phase when profiling.
+inline void _cyclicSCCs(Kripke &kripke, const StateSet &Z, const Labelling &L,
+                        SCCDecomposition &local,
+                        std::vector<IndexRange> &result) {
+    const CSRGraph &G = kripke.csr();
+    const SCCOptions options = L.scc_options();
+    const Condensation &C = kripke.condensation(options);
+    StateSet cut(G.size());
+    bool any_cut = false;
+    for (int k = 0; k < C.sccs.size(); k++) {
+        if (!C.cyclic[k]) {
+            continue;
+        }
+        IndexRange scc = C.sccs[k];
+        std::size_t inside = 0;
+        for (int v : scc) {
+            inside += Z.contains(v);
+        }
+        if (inside == scc.size()) {
+            result.push_back(scc);
+        } else if (inside > 0) {
+            for (int v : scc) {
+                if (Z.contains(v)) {
+                    cut.insert(v);
+                }
+            }
+            any_cut = true;
+        }
+    }
+    if (any_cut) {
+        std::unique_ptr<Profiler::Phase> phase;
+        if (L.options.profiler != nullptr) {
+            phase.reset(new Profiler::Phase(*L.options.profiler, "scc"));
+        }
+        compute_SCCs(G, kripke.predecessors(), local, options, &cut);
+        phase.reset();
+        for (int k = 0; k < local.size(); k++) {
+            if (is_nontrivial_SCC(G, local[k])) {
+                result.push_back(local[k]);
+            }
+        }
+    }
+}
 
-        DiGraph subgraph = kripke.get_subgraph(L[phi->str()]);
-        // subgraph = subgraph.get_reversed_graph();
+// Appends a shortest path of at least one step from `from` to a state
+// satisfying `goal`, moving only through states satisfying `allowed`.
+// `parent` is scratch space of G.size() entries, all -2 on entry and on
+// return; only the states the search visits are touched.
+template <typename Allowed, typename Goal>
+bool _shortestPath(const CSRGraph &G, int from, Allowed allowed, Goal goal,
+                   std::vector<int> &path, std::vector<int> &parent) {
+    std::vector<int> queue;
+    int found = -1;
+    auto visit = [&](int v, int p) {
+        if (!allowed(v) || parent[v] != -2) {
+            return false;
+        }
+        parent[v] = p;
+        queue.push_back(v);
+        if (goal(v)) {
+            found = v;
+            return true;
+        }
+        return false;
+    };
+    bool done = false;
+    for (int w : G.successors(from)) {
+        if ((done = visit(w, -1))) {
+            break;
+        }
+    }
+    for (std::size_t head = 0; !done && head < queue.size(); head++) {
+        int v = queue[head];
+        for (int w : G.successors(v)) {
+            if ((done = visit(w, v))) {
+                break;
+            }
+        }
+    }
+    if (found != -1) {
+        std::size_t first = path.size();
+        for (int w = found; w != -1; w = parent[w]) {
+            path.push_back(w);
+        }
+        std::reverse(path.begin() + first, path.end());
+    }
+    for (int v : queue) {
+        parent[v] = -2;
+    }
+    return found != -1;
+}
 
-        std::vector<std::unordered_set<int>> SCCs;
-        compute_SCCs(subgraph, SCCs);
+// For the fair SCCs of an EG result, listed consecutively in T with their
+// index in `component`: makes the first state of each the entry of a cycle
+// through every set of F, stored in `cycles`, and points next from the
+// other states of the SCC along shortest paths to the entry.
+inline void _fairCycles(const CSRGraph &G, const CSRGraph &pre,
+                        const std::vector<StateSet> &F,
+                        const std::vector<int> &T,
+                        const std::vector<int> &component,
+                        std::vector<int> &next, FairCycles &cycles) {
+    std::vector<int> parent(G.size(), -2);
+    std::vector<std::pair<int, std::vector<int>>> found;
+    for (std::size_t first = 0; first < T.size();) {
+        int entry = T[first];
+        int k = component[entry];
+        auto inside = [&](int w) { return component[w] == k; };
+        std::vector<int> cycle{entry};
+        for (const StateSet &S : F) {
+            if (!S.contains(cycle.back())) {
+                _shortestPath(
+                    G, cycle.back(), inside,
+                    [&](int w) { return S.contains(w); }, cycle, parent);
+            }
+        }
+        _shortestPath(
+            G, cycle.back(), inside, [&](int w) { return w == entry; },
+            cycle, parent);
+        cycle.pop_back();
+        found.emplace_back(entry, std::move(cycle));
 
-        std::unordered_set<int> T;
-        int sccs_size = SCCs.size();
-        for (int i = 0; i < sccs_size; i++) {
-            for (int v : SCCs[i]) {
-                T.insert(v);
+        // Breadth-first from the entry over predecessors in the SCC.
+        std::size_t last = first + 1;
+        while (last < T.size() && component[T[last]] == k) {
+            last++;
+        }
+        std::vector<int> queue{entry};
+        parent[entry] = entry;
+        for (std::size_t head = 0; head < queue.size(); head++) {
+            int v = queue[head];
+            for (int t : pre.successors(v)) {
+                if (inside(t) && parent[t] == -2) {
+                    parent[t] = v;
+                    next[t] = v;
+                    queue.push_back(t);
+                }
             }
         }
+        for (int v : queue) {
+            parent[v] = -2;
+        }
+        next[entry] = -1;
+        first = last;
+    }
+    std::sort(found.begin(), found.end(),
+              [](const std::pair<int, std::vector<int>> &a,
+                 const std::pair<int, std::vector<int>> &b) {
+                  return a.first < b.first;
+              });
+    for (const auto &entry : found) {
+        cycles.entries.push_back(entry.first);
+        cycles.states.insert(cycles.states.end(), entry.second.begin(),
+                             entry.second.end());
+        cycles.offsets.push_back(cycles.states.size());
+    }
+}
 
-        std::vector<std::pair<int, int>> transitions;
-        kripke.transitions(transitions);
+// EG phi, or fair EG phi under fairness constraints: the phi-states with a
+// phi-path into a non-trivial SCC of the phi-subgraph, which under fairness
+// must meet every set of L.fairness. Such an SCC holds a cycle through all
+// sets, so no nested fixpoint is needed. If `next` is given, it receives for
+// each state the successor through which it entered the result. Under
+// fairness, `cycles` then receives a cycle through every set for each fair
+// SCC, and next leads each state of an SCC to the entry of its cycle.
+inline StateSet _EG(Kripke &kripke, const StateSet &in_phi, Labelling &L,
+                    std::vector<int> *next, StepStats *stats,
+                    FairCycles *cycles) {
+    const CSRGraph &G = kripke.csr();
+    const CSRGraph &pre = kripke.predecessors();
+    _condensation(kripke, L);
 
-        while (!T.empty()) {
-            int v = *T.begin();
-            T.erase(T.begin());
+    SCCDecomposition local;
+    std::vector<IndexRange> SCCs;
+    _cyclicSCCs(kripke, in_phi, L, local, SCCs);
 
-            for (int t : L[phi->str()]) {
-                if (kripke._next[t].find(v) != kripke._next[t].end() &&
-                    L[s].find(t) == L[s].end()) {
-                    L[s].insert(t);
-                    T.insert(t);
+    auto is_fair = [&](IndexRange scc) {
+        for (const StateSet &P : L.fairness) {
+            bool found = false;
+            for (int v : scc) {
+                if (P.contains(v)) {
+                    found = true;
+                    break;
                 }
             }
+            if (!found) {
+                return false;
+            }
         }
+        return true;
+    };
+
+    StateSet Lformula(G.size());
+    std::vector<int> T;
+    std::vector<int> component;
+    if (next != nullptr) {
+        next->assign(G.size(), -1);
+        component.assign(G.size(), -1);
+    }
+    for (std::size_t k = 0; k < SCCs.size(); k++) {
+        if (!is_fair(SCCs[k])) {
+            continue;
+        }
+        for (int v : SCCs[k]) {
+            Lformula.insert(v);
+            T.push_back(v);
+            if (next != nullptr) {
+                component[v] = k;
+            }
+        }
+    }
+    if (next != nullptr && !L.fairness.empty() && cycles != nullptr) {
+        _fairCycles(G, pre, L.fairness, T, component, *next, *cycles);
+    } else if (next != nullptr) {
+        // Inside a non-trivial SCC, next stays in the SCC, so following it
+        // from any state of the SCC closes a cycle.
+        for (int v : T) {
+            for (int w : G.successors(v)) {
+                if (component[w] == component[v]) {
+                    (*next)[v] = w;
+                    break;
+                }
+            }
+        }
+    }
+
+    _StepCounter counter(stats);
+    for (std::size_t i = 0; i < T.size(); i++) {
+        int v = T[i];
+        IndexRange sources = pre.successors(v);
+        counter.visit(i, T.size(), sources.size());
+        for (int t : sources) {
+            if (in_phi.contains(t) && Lformula.test_and_insert(t)) {
+                T.push_back(t);
+                if (next != nullptr) {
+                    (*next)[t] = v;
+                }
+            }
+        }
+    }
+    return Lformula;
+}
+
+inline void _checkEG(Kripke &kripke, int id, Labelling &L) {
+    int phi = L.formulas.node(L.formulas.node(id).left).left;
+    _checkStateFormula(kripke, phi, L);
+
+    if (L.options.witnesses) {
+        std::vector<int> next;
+        FairCycles cycles;
+        StateSet Lformula = _EG(kripke, L[phi], L, &next, nullptr, &cycles);
+        L.set_next(id, std::move(next));
+        L.set_cycles(id, std::move(cycles));
+        L.set(id, std::move(Lformula));
+    } else {
+        L.set(id, _EG(kripke, L[phi], L, nullptr));
+    }
+}
+
+// Sets the fairness constraints of L to F (given as state ids) and computes
+// the fair states.
+inline void _setFairness(Kripke &kripke,
+                         const std::vector<std::unordered_set<int>> &F,
+                         Labelling &L) {
+    std::unique_ptr<Profiler::Phase> phase;
+    if (L.options.profiler != nullptr) {
+        phase.reset(new Profiler::Phase(*L.options.profiler, "fairness"));
+    }
+    const CSRGraph &G = kripke.csr();
+    L.fairness.clear();
+    for (const auto &P : F) {
+        StateSet S(G.size());
+        for (int s : P) {
+            if (G.contains(s)) {
+                S.insert(G.index(s));
+            }
+        }
+        L.fairness.push_back(std::move(S));
+    }
+    L.fair = StateSet();
+    if (!L.fairness.empty()) {
+        L.fair = _EG(kripke, StateSet(G.size(), true), L, nullptr);
     }
 }
@@ -3,6 +3,7 @@
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 typedef enum {
@@ -22,15 +23,35 @@ typedef enum {
     R
 } OpCode;
 
+// Symbol that str() prints for a path quantifier or temporal operator.
+inline const char* opcode_symbol(OpCode opcode) {
+    switch (opcode) {
+        case (OpCode::A):
+            return "A";
+        case (OpCode::E):
+            return "E";
+        case (OpCode::X):
+            return "X";
+        case (OpCode::F):
+            return "F";
+        case (OpCode::G):
+            return "G";
+        case (OpCode::U):
+            return "U";
+        case (OpCode::R):
+            return "R";
+        default:
+            return "";
+    }
+}
+
 class Formula {
    public:
     OpCode opcode;
     std::vector<std::shared_ptr<Formula>> subformulas;
-    std::vector<std::string> symbols;
 
-    Formula(OpCode opcode, std::vector<std::shared_ptr<Formula>> subformulas,
-            std::vector<std::string> symbols)
-        : opcode(opcode), subformulas(subformulas), symbols(symbols) {}
+    Formula(OpCode opcode, std::vector<std::shared_ptr<Formula>> subformulas)
+        : opcode(opcode), subformulas(std::move(subformulas)) {}
 
     virtual std::string str() const = 0;
     virtual std::shared_ptr<Formula> get_equivalent_restricted_formula()
@@ -44,7 +65,7 @@ class PathQuantifier : public Formula {
    public:
     using Formula::Formula;
     std::string str() const override {
-        return symbols[0] + "(" + subformulas[0]->str() + ")";
+        return opcode_symbol(opcode) + ("(" + subformulas[0]->str() + ")");
     }
 
     bool is_a_state_formula() const override { return true; }
@@ -55,10 +76,10 @@ class TemporalOperator : public Formula {
     using Formula::Formula;
     std::string str() const override {
         if (subformulas.size() == 1) {
-            return symbols[0] + "(" + subformulas[0]->str() + ")";
+            return opcode_symbol(opcode) + ("(" + subformulas[0]->str() + ")");
         } else {
-            return "(" + subformulas[0]->str() + " " + symbols[0] + " " +
-                   subformulas[1]->str() + ")";
+            return "(" + subformulas[0]->str() + " " + opcode_symbol(opcode) +
+                   " " + subformulas[1]->str() + ")";
         }
     }
     bool is_a_state_formula() const override { return false; }
@@ -85,7 +106,7 @@ namespace CTL {
 class Bool : public Formula {
    public:
     bool val;
-    Bool(bool val) : Formula(OpCode::Bool, {}, {"true", "false"}), val(val) {}
+    Bool(bool val) : Formula(OpCode::Bool, {}), val(val) {}
     std::shared_ptr<Bool> clone() const {
         return std::make_shared<CTL::Bool>(val);
     }
@@ -101,8 +122,7 @@ class Bool : public Formula {
 
 class Not : public LogicOperator {
    public:
-    Not(std::shared_ptr<Formula> phi)
-        : LogicOperator(OpCode::Not, {phi}, {"not", "~"}) {}
+    Not(std::shared_ptr<Formula> phi) : LogicOperator(OpCode::Not, {phi}) {}
     std::string str() const override { return "not " + subformulas[0]->str(); }
 
     std::shared_ptr<Not> clone() const {
@@ -121,7 +141,7 @@ class Not : public LogicOperator {
 class Or : public LogicOperator {
    public:
     Or(std::shared_ptr<Formula> phi, std::shared_ptr<Formula> psi)
-        : LogicOperator(OpCode::Or, {phi, psi}, {"or", "|"}) {}
+        : LogicOperator(OpCode::Or, {phi, psi}) {}
     std::string str() const override {
         return "(" + subformulas[0]->str() + " or " + subformulas[1]->str() +
                ")";
@@ -134,7 +154,7 @@ class Or : public LogicOperator {
 class And : public LogicOperator {
    public:
     And(std::shared_ptr<Formula> phi, std::shared_ptr<Formula> psi)
-        : LogicOperator(OpCode::And, {phi, psi}, {"and", "&"}) {}
+        : LogicOperator(OpCode::And, {phi, psi}) {}
     std::string str() const override {
         return "(" + subformulas[0]->str() + " and " + subformulas[1]->str() +
                ")";
@@ -147,7 +167,7 @@ class And : public LogicOperator {
 class Imply : public LogicOperator {
    public:
     Imply(std::shared_ptr<Formula> phi, std::shared_ptr<Formula> psi)
-        : LogicOperator(OpCode::Imply, {phi, psi}, {"->"}) {}
+        : LogicOperator(OpCode::Imply, {phi, psi}) {}
     std::string str() const override {
         return "(" + subformulas[0]->str() + " -> " + subformulas[1]->str() +
                ")";
@@ -161,7 +181,7 @@ class Imply : public LogicOperator {
 
 class E : public PathQuantifier {
    public:
-    E(std::shared_ptr<Formula> phi) : PathQuantifier(OpCode::E, {phi}, {"E"}) {}
+    E(std::shared_ptr<Formula> phi) : PathQuantifier(OpCode::E, {phi}) {}
 
     std::shared_ptr<Formula> get_equivalent_restricted_formula() const override;
     std::shared_ptr<Formula> get_equivalent_non_fair_formula(
@@ -170,7 +190,7 @@ class E : public PathQuantifier {
 
 class A : public PathQuantifier {
    public:
-    A(std::shared_ptr<Formula> phi) : PathQuantifier(OpCode::A, {phi}, {"A"}) {}
+    A(std::shared_ptr<Formula> phi) : PathQuantifier(OpCode::A, {phi}) {}
 
     std::shared_ptr<Formula> get_equivalent_restricted_formula() const override;
     std::shared_ptr<Formula> get_equivalent_non_fair_formula(
@@ -181,8 +201,7 @@ class A : public PathQuantifier {
 
 class X : public TemporalOperator {
    public:
-    X(std::shared_ptr<Formula> phi)
-        : TemporalOperator(OpCode::X, {phi}, {"X"}) {}
+    X(std::shared_ptr<Formula> phi) : TemporalOperator(OpCode::X, {phi}) {}
 
     std::shared_ptr<Formula> get_equivalent_restricted_formula() const override;
     std::shared_ptr<Formula> get_equivalent_non_fair_formula(
@@ -192,7 +211,7 @@ class X : public TemporalOperator {
 class U : public TemporalOperator {
    public:
     U(std::shared_ptr<Formula> phi, std::shared_ptr<Formula> psi)
-        : TemporalOperator(OpCode::U, {phi, psi}, {"U"}) {}
+        : TemporalOperator(OpCode::U, {phi, psi}) {}
 
     std::shared_ptr<Formula> get_equivalent_restricted_formula() const override;
     std::shared_ptr<Formula> get_equivalent_non_fair_formula(
@@ -202,7 +221,7 @@ class U : public TemporalOperator {
 class R : public TemporalOperator {
    public:
     R(std::shared_ptr<Formula> phi, std::shared_ptr<Formula> psi)
-        : TemporalOperator(OpCode::R, {phi, psi}, {"R"}) {}
+        : TemporalOperator(OpCode::R, {phi, psi}) {}
 
     std::shared_ptr<Formula> get_equivalent_restricted_formula() const override;
     std::shared_ptr<Formula> get_equivalent_non_fair_formula(
@@ -211,8 +230,7 @@ class R : public TemporalOperator {
 
 class F : public TemporalOperator {
    public:
-    F(std::shared_ptr<Formula> phi)
-        : TemporalOperator(OpCode::F, {phi}, {"F"}) {}
+    F(std::shared_ptr<Formula> phi) : TemporalOperator(OpCode::F, {phi}) {}
 
     std::shared_ptr<Formula> get_equivalent_restricted_formula() const override;
     std::shared_ptr<Formula> get_equivalent_non_fair_formula(
@@ -221,8 +239,7 @@ class F : public TemporalOperator {
 
 class G : public TemporalOperator {
    public:
-    G(std::shared_ptr<Formula> phi)
-        : TemporalOperator(OpCode::G, {phi}, {"G"}) {}
+    G(std::shared_ptr<Formula> phi) : TemporalOperator(OpCode::G, {phi}) {}
 
     std::shared_ptr<Formula> get_equivalent_restricted_formula() const override;
     std::shared_ptr<Formula> get_equivalent_non_fair_formula(
@@ -235,7 +252,7 @@ class AtomicProposition : public Formula {
    public:
     std::string name;
     AtomicProposition(std::string name)
-        : Formula(OpCode::Atomic, {}, {}), name(name) {}
+        : Formula(OpCode::Atomic, {}), name(name) {}
 
     std::shared_ptr<AtomicProposition> clone() const {
         return std::make_shared<AtomicProposition>(name);
@@ -0,0 +1,305 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "formula.h"
+
+// A subformula in a FormulaTable. Children are referred to by id (-1 if
+// absent); `ap` is the interned name of an atomic proposition, or the value
+// of a Bool constant.
+struct FormulaNode {
+    OpCode opcode;
+    int left;
+    int right;
+    int ap;
+};
+
+// Hash-consing table for formulas. Every structurally unique subformula gets
+// a stable integer id, so two formulas are equal iff their ids are equal and
+// results can be cached per id instead of per str(). The table owns its
+// nodes in one array, and rewrites work on ids, so building or rewriting a
+// formula here allocates nothing per node beyond its slot and hash entry.
+class FormulaTable {
+   public:
+    int intern(const std::shared_ptr<Formula>& formula) {
+        std::unordered_map<const Formula*, int> visited;
+        return intern(formula, visited);
+    }
+
+    // Builders for formulas made directly in the table, e.g. by generators
+    // of large property sets.
+    int constant(bool value) {
+        return unique(Key{OpCode::Bool, -1, -1, value});
+    }
+
+    int atomic(const std::string& name) {
+        return unique(Key{OpCode::Atomic, -1, -1, intern_ap(name)});
+    }
+
+    int make(OpCode opcode, int left, int right = -1) {
+        if (left < 0 || left >= size() || right < -1 || right >= size()) {
+            throw std::runtime_error("Unknown subformula id");
+        }
+        return unique(Key{opcode, left, right, -1});
+    }
+
+    // Negation of `id`, dropping a double negation.
+    int negate(int id) {
+        if (_nodes[id].opcode == OpCode::Not) {
+            return _nodes[id].left;
+        }
+        return unique(Key{OpCode::Not, id, -1, -1});
+    }
+
+    int size() const { return _nodes.size(); }
+
+    const FormulaNode& node(int id) const { return _nodes[id]; }
+
+    std::string str(int id) const {
+        const FormulaNode& n = _nodes[id];
+        switch (n.opcode) {
+            case (OpCode::Bool):
+                return n.ap ? "true" : "false";
+            case (OpCode::Atomic):
+                return _ap_names[n.ap];
+            case (OpCode::Not):
+                return "not " + str(n.left);
+            case (OpCode::Or):
+                return "(" + str(n.left) + " or " + str(n.right) + ")";
+            case (OpCode::And):
+                return "(" + str(n.left) + " and " + str(n.right) + ")";
+            case (OpCode::Imply):
+                return "(" + str(n.left) + " -> " + str(n.right) + ")";
+            default:
+                if (n.right == -1) {
+                    return opcode_symbol(n.opcode) + ("(" + str(n.left) + ")");
+                }
+                return "(" + str(n.left) + " " + opcode_symbol(n.opcode) +
+                       " " + str(n.right) + ")";
+        }
+    }
+
+    const std::string& ap_name(int ap) const { return _ap_names[ap]; }
+
+    int num_aps() const { return _ap_names.size(); }
+
+    bool is_restricted(int id) const {
+        const FormulaNode& n = _nodes[id];
+        switch (n.opcode) {
+            case (OpCode::Atomic):
+            case (OpCode::Bool):
+            case (OpCode::Not):
+            case (OpCode::Or):
+                return true;
+            case (OpCode::E): {
+                OpCode p = _nodes[n.left].opcode;
+                return p == OpCode::X || p == OpCode::U || p == OpCode::G;
+            }
+            default:
+                return false;
+        }
+    }
+
+    // Id of the equivalent formula over {Not, Or, EX, EU, EG}; the rewrite
+    // is done once per id, and later calls only read the table.
+    int restricted(int id) {
+        if (is_restricted(id)) {
+            return id;
+        }
+        return rewrite(id);
+    }
+
+   private:
+    struct Key {
+        OpCode opcode;
+        int left;
+        int right;
+        int ap;
+
+        bool operator==(const Key& other) const {
+            return opcode == other.opcode && left == other.left &&
+                   right == other.right && ap == other.ap;
+        }
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key& k) const {
+            std::size_t h = std::size_t(k.opcode);
+            h = h * 1000003 ^ std::size_t(k.left + 1);
+            h = h * 1000003 ^ std::size_t(k.right + 1);
+            h = h * 1000003 ^ std::size_t(k.ap + 1);
+            return h;
+        }
+    };
+
+    std::vector<FormulaNode> _nodes;
+    std::unordered_map<Key, int, KeyHash> _unique;
+    std::vector<std::string> _ap_names;
+    std::unordered_map<std::string, int> _ap_ids;
+    // Rewrite of each id into the restricted basis, or -1 if not done yet.
+    std::vector<int> _restricted;
+
+    int unique(const Key& key) {
+        auto entry = _unique.find(key);
+        if (entry != _unique.end()) {
+            return entry->second;
+        }
+        int id = _nodes.size();
+        _nodes.push_back(FormulaNode{key.opcode, key.left, key.right, key.ap});
+        _unique.emplace(key, id);
+        return id;
+    }
+
+    // Rewrites `id` and all of its subformulas into the restricted basis.
+    int rewrite(int id) {
+        if (id < int(_restricted.size()) && _restricted[id] != -1) {
+            return _restricted[id];
+        }
+        FormulaNode n = _nodes[id];
+        int result;
+        switch (n.opcode) {
+            case (OpCode::Bool):
+            case (OpCode::Atomic): {
+                result = id;
+                break;
+            }
+            case (OpCode::Not): {
+                result = negate(rewrite(n.left));
+                break;
+            }
+            case (OpCode::Or): {
+                result = make(OpCode::Or, rewrite(n.left), rewrite(n.right));
+                break;
+            }
+            case (OpCode::And): {
+                int l = negate(rewrite(n.left));
+                int r = negate(rewrite(n.right));
+                result = negate(make(OpCode::Or, l, r));
+                break;
+            }
+            case (OpCode::Imply): {
+                int l = negate(rewrite(n.left));
+                result = make(OpCode::Or, l, rewrite(n.right));
+                break;
+            }
+            case (OpCode::E): {
+                result = rewrite_E(id);
+                break;
+            }
+            case (OpCode::A): {
+                result = rewrite_A(id);
+                break;
+            }
+            default:
+                throw std::runtime_error(str(id) + " is not a state formula");
+        }
+        _restricted.resize(_nodes.size(), -1);
+        _restricted[id] = result;
+        return result;
+    }
+
+    int EX(int phi) { return make(OpCode::E, make(OpCode::X, phi)); }
+
+    int EU(int phi, int psi) {
+        return make(OpCode::E, make(OpCode::U, phi, psi));
+    }
+
+    int EG(int phi) { return make(OpCode::E, make(OpCode::G, phi)); }
+
+    int rewrite_E(int id) {
+        FormulaNode path = _nodes[_nodes[id].left];
+        int sf0 = rewrite(path.left);
+        switch (path.opcode) {
+            case (OpCode::X):
+                return EX(sf0);
+            case (OpCode::F):
+                return EU(constant(true), sf0);
+            case (OpCode::G):
+                return EG(sf0);
+            case (OpCode::U):
+                return EU(sf0, rewrite(path.right));
+            case (OpCode::R): {
+                int sf1 = rewrite(path.right);
+                int neither =
+                    negate(make(OpCode::Or, negate(sf0), negate(sf1)));
+                return make(OpCode::Or, EU(sf1, neither), EG(sf1));
+            }
+            default:
+                throw std::runtime_error(str(id) + " is not a CTL formula");
+        }
+    }
+
+    int rewrite_A(int id) {
+        FormulaNode path = _nodes[_nodes[id].left];
+        int sf0 = rewrite(path.left);
+        switch (path.opcode) {
+            case (OpCode::X):
+                return negate(EX(negate(sf0)));
+            case (OpCode::F):
+                return negate(EG(negate(sf0)));
+            case (OpCode::G):
+                return negate(EU(constant(true), negate(sf0)));
+            case (OpCode::U): {
+                int sf1 = rewrite(path.right);
+                int neg_sf1 = negate(sf1);
+                int neither = negate(make(OpCode::Or, sf0, sf1));
+                return negate(
+                    make(OpCode::Or, EU(neg_sf1, neither), EG(neg_sf1)));
+            }
+            case (OpCode::R): {
+                int sf1 = rewrite(path.right);
+                return negate(EU(negate(sf0), negate(sf1)));
+            }
+            default:
+                throw std::runtime_error(str(id) + " is not a CTL formula");
+        }
+    }
+
+    int intern(const std::shared_ptr<Formula>& formula,
+               std::unordered_map<const Formula*, int>& visited) {
+        auto found = visited.find(formula.get());
+        if (found != visited.end()) {
+            return found->second;
+        }
+
+        Key key{formula->opcode, -1, -1, -1};
+        switch (formula->opcode) {
+            case (OpCode::Bool): {
+                key.ap = static_cast<const CTL::Bool*>(formula.get())->val;
+                break;
+            }
+            case (OpCode::Atomic): {
+                key.ap = intern_ap(
+                    static_cast<const CTL::AtomicProposition*>(formula.get())
+                        ->name);
+                break;
+            }
+            default: {
+                if (formula->subformulas.size() > 0) {
+                    key.left = intern(formula->subformulas[0], visited);
+                }
+                if (formula->subformulas.size() > 1) {
+                    key.right = intern(formula->subformulas[1], visited);
+                }
+            }
+        }
+
+        int id = unique(key);
+        visited.emplace(formula.get(), id);
+        return id;
+    }
+
+    int intern_ap(const std::string& name) {
+        auto found = _ap_ids.find(name);
+        if (found != _ap_ids.end()) {
+            return found->second;
+        }
+        _ap_names.push_back(name);
+        _ap_ids.emplace(name, _ap_names.size() - 1);
+        return _ap_names.size() - 1;
+    }
+};
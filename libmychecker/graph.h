@@ -1,9 +1,22 @@
 #pragma once
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "stateset.h"
+
+// Approximate heap bytes of a node-based hash container with `size` entries
+// of `entry` bytes: one pointer per bucket and one per entry.
+inline std::size_t _hashBytes(std::size_t size, std::size_t buckets,
+                              std::size_t entry) {
+    return buckets * sizeof(void*) + size * (entry + sizeof(void*));
+}
+
 class DiGraph {
    public:
     std::unordered_map<int, std::unordered_set<int>> _next;
@@ -82,6 +95,18 @@ class DiGraph {
         }
     }
 
+    // Approximate heap bytes of the adjacency sets.
+    std::size_t bytes() const {
+        std::size_t total =
+            _hashBytes(_next.size(), _next.bucket_count(),
+                       sizeof(std::pair<const int, std::unordered_set<int>>));
+        for (const auto& entry : _next) {
+            total += _hashBytes(entry.second.size(),
+                                entry.second.bucket_count(), sizeof(int));
+        }
+        return total;
+    }
+
     DiGraph clone() const {
         std::unordered_set<int> nV;
         std::vector<std::pair<int, int>> nE;
@@ -174,77 +199,501 @@ class DiGraph {
     }
 };
 
-inline void compute_SCCs(const DiGraph& G,
-                  std::vector<std::unordered_set<int>>& result) {
-    std::unordered_map<int, int> disc;
-    std::unordered_map<int, int> lowlink;
-    std::unordered_set<int> in_a_scc;
-    std::vector<int> scc_stack;
-    int time = 0;
+// A half-open range of dense node indices.
+class IndexRange {
+   public:
+    IndexRange(const int* first, const int* last) : first(first), last(last) {}
+    const int* begin() const { return first; }
+    const int* end() const { return last; }
+    std::size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+
+   private:
+    const int* first;
+    const int* last;
+};
+
+// Owned storage of a CSRGraph.
+struct CSRArrays {
+    std::vector<int> ids;
+    std::vector<std::size_t> offsets;
+    std::vector<int> targets;
+};
+
+// Immutable compressed-sparse-row graph over dense indices 0..size()-1.
+// Index i stands for the node id(i); the successors of i are the sorted
+// targets[offsets[i] .. offsets[i+1]). The arrays are either owned by the
+// graph or borrowed from a `storage` object (such as a mapped file) that the
+// graph keeps alive; copies share them.
+class CSRGraph {
+   public:
+    CSRGraph() : CSRGraph(std::vector<int>(), {0}, std::vector<int>()) {}
+
+    CSRGraph(std::vector<int> ids, std::vector<std::size_t> offsets,
+             std::vector<int> targets) {
+        if (offsets.size() != ids.size() + 1 ||
+            offsets.back() != targets.size()) {
+            throw std::runtime_error("Malformed CSR arrays");
+        }
+        int n = ids.size();
+        for (int v = 0; v < n; v++) {
+            std::sort(targets.begin() + offsets[v],
+                      targets.begin() + offsets[v + 1]);
+        }
+        adopt(std::move(ids), std::move(offsets), std::move(targets));
+        build_index();
+    }
+
+    explicit CSRGraph(const DiGraph& G) : CSRGraph(G, sorted_nodes(G)) {}
+
+    // Numbers the nodes of G in the order of `ids`, which must list each
+    // node exactly once.
+    CSRGraph(const DiGraph& G, std::vector<int> ids) {
+        int n = ids.size();
+        if (std::size_t(n) != G._next.size()) {
+            throw std::runtime_error("Node order does not match the DiGraph");
+        }
+        std::unordered_map<int, int> index;
+        index.reserve(n);
+        for (int v = 0; v < n; v++) {
+            index[ids[v]] = v;
+        }
+
+        std::vector<std::size_t> offsets(n + 1, 0);
+        for (int v = 0; v < n; v++) {
+            offsets[v + 1] = offsets[v] + G._next.at(ids[v]).size();
+        }
+        std::vector<int> targets(offsets[n]);
+        for (int v = 0; v < n; v++) {
+            int* out = targets.data() + offsets[v];
+            for (int w : G._next.at(ids[v])) {
+                *out++ = index[w];
+            }
+            std::sort(targets.begin() + offsets[v],
+                      targets.begin() + offsets[v + 1]);
+        }
+        adopt(std::move(ids), std::move(offsets), std::move(targets));
+        build_index();
+    }
+
+    // Borrows the arrays of a graph with n nodes from `storage`. Rows must
+    // already be sorted, with increasing offsets and targets in [0, n);
+    // only the first offset is checked here, so untrusted arrays must be
+    // validated by the caller, as load_kripke can. If `sorted_ids`, the ids
+    // must be strictly increasing: they are then looked up by binary search
+    // in place, without building an index.
+    CSRGraph(std::shared_ptr<const void> storage, int n, const int* ids,
+             const std::size_t* offsets, const int* targets,
+             bool sorted_ids = false)
+        : _storage(std::move(storage)),
+          _n(n),
+          _ids(ids),
+          _offsets(offsets),
+          _targets(targets) {
+        if (n < 0 || offsets[0] != 0) {
+            throw std::runtime_error("Malformed CSR arrays");
+        }
+        _m = offsets[n];
+        if (sorted_ids) {
+            // Strictly increasing ids from 0 to n-1 are 0..n-1.
+            _identity = n == 0 || (ids[0] == 0 && ids[n - 1] == n - 1);
+            _sorted = !_identity;
+            _index = std::make_shared<std::unordered_map<int, int>>();
+        } else {
+            build_index();
+        }
+    }
+
+    int size() const { return _n; }
+    std::size_t num_edges() const { return _m; }
+
+    IndexRange successors(int v) const {
+        return IndexRange(_targets + _offsets[v], _targets + _offsets[v + 1]);
+    }
+
+    bool has_edge(int src, int dst) const {
+        IndexRange succ = successors(src);
+        return std::binary_search(succ.begin(), succ.end(), dst);
+    }
+
+    int id(int v) const { return _ids[v]; }
+    IndexRange ids() const { return IndexRange(_ids, _ids + _n); }
+
+    // Bytes of the arrays and the id index, whether owned, shared with
+    // copies or mapped.
+    std::size_t bytes() const {
+        std::size_t total = _n * sizeof(int) + (_n + 1) * sizeof(std::size_t) +
+                            _m * sizeof(int);
+        if (!_identity && !_sorted) {
+            total += _hashBytes(_index->size(), _index->bucket_count(),
+                                sizeof(std::pair<const int, int>));
+        }
+        return total;
+    }
+
+    const std::size_t* offsets() const { return _offsets; }
+    const int* targets() const { return _targets; }
+
+    bool contains(int id) const {
+        if (_identity) {
+            return id >= 0 && id < size();
+        }
+        if (_sorted) {
+            return std::binary_search(_ids, _ids + _n, id);
+        }
+        return _index->find(id) != _index->end();
+    }
+
+    int index(int id) const {
+        if (!contains(id)) {
+            throw std::runtime_error("Node not found in the CSRGraph");
+        }
+        if (_sorted) {
+            return std::lower_bound(_ids, _ids + _n, id) - _ids;
+        }
+        return _identity ? id : _index->at(id);
+    }
+
+    // Returns the transposed graph over the same dense indices.
+    CSRGraph reversed() const {
+        int n = size();
+        std::vector<std::size_t> offsets(n + 1, 0);
+        for (std::size_t e = 0; e < _m; e++) {
+            offsets[_targets[e] + 1]++;
+        }
+        for (int v = 0; v < n; v++) {
+            offsets[v + 1] += offsets[v];
+        }
+
+        std::vector<int> targets(_m);
+        std::vector<std::size_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (int v = 0; v < n; v++) {
+            for (int w : successors(v)) {
+                targets[cursor[w]++] = v;
+            }
+        }
+
+        CSRGraph R(*this);
+        R.adopt(std::vector<int>(_ids, _ids + n), std::move(offsets),
+                std::move(targets));
+        return R;
+    }
+
+    DiGraph to_digraph() const {
+        std::unordered_set<int> V(_ids, _ids + _n);
+        std::vector<std::pair<int, int>> E;
+        E.reserve(num_edges());
+        int n = size();
+        for (int v = 0; v < n; v++) {
+            for (int w : successors(v)) {
+                E.push_back(std::make_pair(_ids[v], _ids[w]));
+            }
+        }
+        return DiGraph(V, E);
+    }
+
+   private:
+    static std::vector<int> sorted_nodes(const DiGraph& G) {
+        std::vector<int> ids;
+        G.nodes(ids);
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+
+    std::shared_ptr<const void> _storage;
+    int _n;
+    std::size_t _m;
+    const int* _ids;
+    const std::size_t* _offsets;
+    const int* _targets;
+    // Ids are looked up directly if they are 0..n-1, by binary search if
+    // they are borrowed in sorted order, and through _index otherwise.
+    std::shared_ptr<const std::unordered_map<int, int>> _index;
+    bool _identity;
+    bool _sorted = false;
+
+    void adopt(std::vector<int> ids, std::vector<std::size_t> offsets,
+               std::vector<int> targets) {
+        auto arrays = std::make_shared<CSRArrays>();
+        arrays->ids = std::move(ids);
+        arrays->offsets = std::move(offsets);
+        arrays->targets = std::move(targets);
+        _n = arrays->ids.size();
+        _m = arrays->targets.size();
+        _ids = arrays->ids.data();
+        _offsets = arrays->offsets.data();
+        _targets = arrays->targets.data();
+        _storage = std::move(arrays);
+    }
 
-    auto dfs = [&](int s) {
-        disc[s] = time;
-        lowlink[s] = time;
-
-        std::unordered_set<int> next_s;
-        G.next(s, next_s);
-        std::vector<std::pair<int, std::unordered_set<int>::iterator>> stack{
-            {s, next_s.begin()}};
-        while (!stack.empty()) {
-            try {
-                auto& top = stack.back();
-                int w = *(top.second);
-
-                if (disc.find(w) == disc.end()) {
-                    time++;
-                    disc[w] = time;
-                    lowlink[w] = time;
-
-                    std::unordered_set<int> next_w;
-                    G.next(w, next_w);
-                    stack.push_back({w, next_w.begin()});
+    void build_index() {
+        int n = size();
+        _identity = true;
+        for (int v = 0; v < n && _identity; v++) {
+            _identity = _ids[v] == v;
+        }
+        auto index = std::make_shared<std::unordered_map<int, int>>();
+        if (!_identity) {
+            index->reserve(n);
+            for (int v = 0; v < n; v++) {
+                if (!index->emplace(_ids[v], v).second) {
+                    throw std::runtime_error("Duplicate node id " +
+                                             std::to_string(_ids[v]));
                 }
+            }
+        }
+        _index = std::move(index);
+    }
+};
+
+// SCCs stored as ranges of one node array: SCC k is
+// nodes[offsets[k] .. offsets[k+1]).
+class SCCDecomposition {
+   public:
+    SCCDecomposition() : offsets{0} {}
+
+    int size() const { return offsets.size() - 1; }
+
+    IndexRange operator[](int k) const {
+        return IndexRange(nodes.data() + offsets[k],
+                          nodes.data() + offsets[k + 1]);
+    }
+
+    void clear() {
+        nodes.clear();
+        offsets.assign(1, 0);
+    }
+
+    void push_back(const int* first, const int* last) {
+        nodes.insert(nodes.end(), first, last);
+        offsets.push_back(nodes.size());
+    }
+
+    std::size_t bytes() const {
+        return (nodes.capacity() + offsets.capacity()) * sizeof(int);
+    }
+
+    std::vector<int> nodes;
+    std::vector<int> offsets;
+};
+
+// Scratch arrays for compute_SCCs. They are sized on first use and reused
+// afterwards, so repeated decompositions of graphs of the same size do not
+// allocate.
+struct SCCWorkspace {
+    void reserve(int n) {
+        if (int(index.size()) < n) {
+            index.resize(n);
+            lowlink.resize(n);
+            stack.resize(n);
+            call_node.resize(n);
+            call_edge.resize(n);
+        }
+    }
+
+    std::vector<int> index;
+    std::vector<int> lowlink;
+    std::vector<int> stack;
+    std::vector<int> call_node;
+    std::vector<const int*> call_edge;
+};
+
+// Iterative Tarjan over a CSRGraph. SCCs are reported as dense indices in
+// reverse topological order. If `mask` is given, only the subgraph induced by
+// its members is considered. Successors are walked in place and all state
+// lives in `ws`, so the only allocations are the growth of `result`.
+inline void compute_SCCs(const CSRGraph& G, SCCDecomposition& result,
+                         SCCWorkspace& ws, const StateSet* mask = nullptr) {
+    const int n = G.size();
+    const int unvisited = -1;
+    // Nodes already assigned to an SCC get this index so that they can no
+    // longer lower the lowlink of a node still on the stack.
+    const int assigned = n;
+    ws.reserve(n);
+    int* index = ws.index.data();
+    int* lowlink = ws.lowlink.data();
+    int* stack = ws.stack.data();
+    int* call_node = ws.call_node.data();
+    const int** call_edge = ws.call_edge.data();
+
+    result.clear();
+    result.nodes.reserve(n);
+    for (int v = 0; v < n; v++) {
+        bool in_graph = mask == nullptr || mask->contains(v);
+        index[v] = in_graph ? unvisited : assigned;
+    }
+
+    int time = 0;
+    int stack_top = 0;
+    for (int s = 0; s < n; s++) {
+        if (index[s] != unvisited) {
+            continue;
+        }
+
+        int depth = 0;
+        index[s] = lowlink[s] = time++;
+        stack[stack_top++] = s;
+        call_node[depth] = s;
+        call_edge[depth++] = G.successors(s).begin();
+
+        while (depth > 0) {
+            int v = call_node[depth - 1];
+            const int* last = G.successors(v).end();
+            const int*& it = call_edge[depth - 1];
 
-            } catch (const std::out_of_range&) {
-                int v = stack.back().first;
-                stack.pop_back();
-
-                std::unordered_set<int> next_v;
-                G.next(v, next_v);
-                for (int w : next_v) {
-                    if (in_a_scc.find(w) == in_a_scc.end()) {
-                        if (disc[w] > disc[v]) {
-                            lowlink[v] = std::min(lowlink[v], lowlink[w]);
-                        } else {
-                            lowlink[v] = std::min(lowlink[v], disc[w]);
-                        }
-                    }
+            while (it != last && index[*it] != unvisited) {
+                lowlink[v] = std::min(lowlink[v], index[*it]);
+                ++it;
+            }
+
+            if (it != last) {
+                int w = *it++;
+                index[w] = lowlink[w] = time++;
+                stack[stack_top++] = w;
+                call_node[depth] = w;
+                call_edge[depth++] = G.successors(w).begin();
+                continue;
+            }
+
+            depth--;
+            if (depth > 0) {
+                int u = call_node[depth - 1];
+                lowlink[u] = std::min(lowlink[u], lowlink[v]);
+            }
+
+            if (lowlink[v] == index[v]) {
+                int first = stack_top;
+                do {
+                    first--;
+                } while (stack[first] != v);
+                for (int k = first; k < stack_top; k++) {
+                    index[stack[k]] = assigned;
                 }
+                result.push_back(stack + first, stack + stack_top);
+                stack_top = first;
+            }
+        }
+    }
+}
+
+inline void compute_SCCs(const CSRGraph& G, SCCDecomposition& result,
+                         const StateSet* mask = nullptr) {
+    thread_local SCCWorkspace ws;
+    compute_SCCs(G, result, ws, mask);
+}
+
+// An SCC is non-trivial if it contains a cycle, i.e. it has more than one
+// node or a self-loop.
+inline bool is_nontrivial_SCC(const CSRGraph& G, IndexRange scc) {
+    return scc.size() > 1 || G.has_edge(*scc.begin(), *scc.begin());
+}
+
+// The SCCs of a graph together with the component of every node and the
+// condensation DAG, which has an edge k -> j whenever an edge leads from SCC
+// k into a different SCC j. Components are numbered in reverse topological
+// order, so every DAG edge leads to a smaller id.
+struct Condensation {
+    SCCDecomposition sccs;
+    std::vector<int> component;
+    CSRGraph dag;
+    // Whether SCC k contains a cycle.
+    std::vector<char> cyclic;
+
+    std::size_t bytes() const {
+        return sccs.bytes() + component.capacity() * sizeof(int) +
+               dag.bytes() + cyclic.capacity();
+    }
+};
 
-                if (lowlink[v] == disc[v]) {
-                    in_a_scc.insert(v);
-                    std::unordered_set<int> scc = {v};
-                    while (!scc_stack.empty() &&
-                           disc[scc_stack.back()] > disc[v]) {
-                        int k = scc_stack.back();
-                        scc_stack.pop_back();
-                        in_a_scc.insert(k);
-                        scc.insert(k);
-                    }
-                    result.emplace_back(scc);
-                } else {
-                    scc_stack.push_back(v);
+// Builds the condensation of G from its SCCs, given in any order.
+inline void condense(const CSRGraph& G, const SCCDecomposition& sccs,
+                     Condensation& result) {
+    const int n = G.size();
+    const int c = sccs.size();
+    std::vector<int> component(n);
+    for (int k = 0; k < c; k++) {
+        for (int v : sccs[k]) {
+            component[v] = k;
+        }
+    }
+
+    std::vector<std::size_t> offsets{0};
+    std::vector<int> targets;
+    std::vector<int> last(c, -1);
+    std::vector<int> indegree(c, 0);
+    for (int k = 0; k < c; k++) {
+        last[k] = k;
+        for (int v : sccs[k]) {
+            for (int w : G.successors(v)) {
+                int j = component[w];
+                if (last[j] != k) {
+                    last[j] = k;
+                    targets.push_back(j);
+                    indegree[j]++;
                 }
             }
         }
-    };
+        offsets.push_back(targets.size());
+    }
+
+    // Kahn's algorithm; the first component of the topological order gets
+    // the largest id.
+    std::vector<int> order;
+    order.reserve(c);
+    for (int k = 0; k < c; k++) {
+        if (indegree[k] == 0) {
+            order.push_back(k);
+        }
+    }
+    for (int i = 0; i < int(order.size()); i++) {
+        int k = order[i];
+        for (std::size_t e = offsets[k]; e < offsets[k + 1]; e++) {
+            if (--indegree[targets[e]] == 0) {
+                order.push_back(targets[e]);
+            }
+        }
+    }
+    std::vector<int> rank(c);
+    for (int i = 0; i < c; i++) {
+        rank[order[i]] = c - 1 - i;
+    }
 
-    std::vector<int> vecV;
-    G.nodes(vecV);
-    for (int s : vecV) {
-        if (disc.find(s) == disc.end()) {
-            dfs(s);
+    result.sccs.clear();
+    result.sccs.nodes.reserve(n);
+    result.cyclic.assign(c, 0);
+    std::vector<int> ids(c);
+    std::vector<std::size_t> dag_offsets{0};
+    std::vector<int> dag_targets;
+    dag_targets.reserve(targets.size());
+    for (int r = 0; r < c; r++) {
+        int k = order[c - 1 - r];
+        IndexRange scc = sccs[k];
+        result.sccs.push_back(scc.begin(), scc.end());
+        result.cyclic[r] = is_nontrivial_SCC(G, scc);
+        ids[r] = r;
+        for (std::size_t e = offsets[k]; e < offsets[k + 1]; e++) {
+            dag_targets.push_back(rank[targets[e]]);
         }
+        dag_offsets.push_back(dag_targets.size());
+    }
+    for (int v = 0; v < n; v++) {
+        component[v] = rank[component[v]];
     }
+    result.component = std::move(component);
+    result.dag = CSRGraph(std::move(ids), std::move(dag_offsets),
+                          std::move(dag_targets));
 }
 
+inline void compute_SCCs(const DiGraph& G,
+                         std::vector<std::unordered_set<int>>& result) {
+    CSRGraph csr(G);
+    SCCDecomposition sccs;
+    compute_SCCs(csr, sccs);
+    for (int k = 0; k < sccs.size(); k++) {
+        std::unordered_set<int> scc;
+        for (int v : sccs[k]) {
+            scc.insert(csr.id(v));
+        }
+        result.emplace_back(std::move(scc));
+    }
+}
@@ -0,0 +1,344 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "checker.h"
+#include "graph.h"
+#include "kripke.h"
+#include "local.h"
+#include "stateset.h"
+
+// A Kripke structure given implicitly: states are opaque 64-bit values, and
+// the model only has to enumerate its initial states, generate the
+// successors of a state and decide whether an AP labels a state.
+class ImplicitModel {
+   public:
+    typedef std::uint64_t State;
+
+    virtual ~ImplicitModel() {}
+
+    virtual void initial_states(std::vector<State>& result) const = 0;
+    virtual void successors(State s, std::vector<State>& result) const = 0;
+    virtual bool label(State s, const std::string& ap) const = 0;
+};
+
+// An ImplicitModel built from three callables.
+class CallbackModel : public ImplicitModel {
+   public:
+    CallbackModel(
+        std::function<void(std::vector<State>&)> initial,
+        std::function<void(State, std::vector<State>&)> successors,
+        std::function<bool(State, const std::string&)> label)
+        : _initial(std::move(initial)),
+          _successors(std::move(successors)),
+          _label(std::move(label)) {}
+
+    void initial_states(std::vector<State>& result) const override {
+        _initial(result);
+    }
+
+    void successors(State s, std::vector<State>& result) const override {
+        _successors(s, result);
+    }
+
+    bool label(State s, const std::string& ap) const override {
+        return _label(s, ap);
+    }
+
+   private:
+    std::function<void(std::vector<State>&)> _initial;
+    std::function<void(State, std::vector<State>&)> _successors;
+    std::function<bool(State, const std::string&)> _label;
+};
+
+// Visited-state store: numbers model states densely in insertion order. It
+// keeps each state once in a vector and finds it through an open-addressing
+// table of 32-bit indices, so it costs 8 bytes per state plus 4 per slot.
+class StateStore {
+   public:
+    typedef ImplicitModel::State State;
+
+    StateStore() : _slots(1024, -1) {}
+
+    int size() const { return _states.size(); }
+
+    State state(int i) const { return _states[i]; }
+
+    int find(State s) const {
+        std::size_t mask = _slots.size() - 1;
+        for (std::size_t i = hash(s) & mask;; i = (i + 1) & mask) {
+            int k = _slots[i];
+            if (k == -1) {
+                return -1;
+            }
+            if (_states[k] == s) {
+                return k;
+            }
+        }
+    }
+
+    // Index of s; if s is new it is added and `inserted` is set.
+    int insert(State s, bool& inserted) {
+        std::size_t mask = _slots.size() - 1;
+        std::size_t i = hash(s) & mask;
+        for (;; i = (i + 1) & mask) {
+            int k = _slots[i];
+            if (k == -1) {
+                break;
+            }
+            if (_states[k] == s) {
+                inserted = false;
+                return k;
+            }
+        }
+        if (_states.size() >= std::size_t(INT32_MAX)) {
+            throw std::runtime_error("Too many states to store");
+        }
+        inserted = true;
+        int k = _states.size();
+        _states.push_back(s);
+        _slots[i] = k;
+        if (4 * _states.size() > 3 * _slots.size()) {
+            rehash();
+        }
+        return k;
+    }
+
+   private:
+    std::vector<State> _states;
+    std::vector<int> _slots;
+
+    static std::size_t hash(State s) {
+        s ^= s >> 33;
+        s *= 0xff51afd7ed558ccdULL;
+        s ^= s >> 33;
+        s *= 0xc4ceb9fe1a85ec53ULL;
+        s ^= s >> 33;
+        return s;
+    }
+
+    void rehash() {
+        _slots.assign(2 * _slots.size(), -1);
+        std::size_t mask = _slots.size() - 1;
+        for (std::size_t k = 0; k < _states.size(); k++) {
+            std::size_t i = hash(_states[k]) & mask;
+            while (_slots[i] != -1) {
+                i = (i + 1) & mask;
+            }
+            _slots[i] = k;
+        }
+    }
+};
+
+// The states of an ImplicitModel numbered in a StateStore as a search
+// reaches them. The successors of a state are generated when first asked
+// for, and an AP is evaluated on a state at most once.
+class _ImplicitGraph {
+   public:
+    typedef ImplicitModel::State State;
+
+    _ImplicitGraph(const ImplicitModel& model, std::size_t max_states)
+        : _model(&model), _max_states(max_states) {}
+
+    int size() const { return _states.size(); }
+
+    const StateStore& states() const { return _states; }
+
+    // Dense index of s, numbering it if it is new.
+    int index(State s) {
+        bool inserted;
+        int v = _states.insert(s, inserted);
+        if (inserted && _max_states != 0 &&
+            std::size_t(_states.size()) > _max_states) {
+            throw std::runtime_error("More than " +
+                                     std::to_string(_max_states) +
+                                     " reachable states");
+        }
+        return v;
+    }
+
+    IndexRange successors(int v) {
+        if (v >= int(_rows.size())) {
+            _rows.resize(v + 1);
+            _expanded.resize(v + 1, 0);
+        }
+        if (!_expanded[v]) {
+            _buffer.clear();
+            _model->successors(_states.state(v), _buffer);
+            std::vector<int> row;
+            for (State s : _buffer) {
+                row.push_back(index(s));
+            }
+            std::sort(row.begin(), row.end());
+            row.erase(std::unique(row.begin(), row.end()), row.end());
+            // Rows are never touched again, and the deque does not move
+            // them, so the range stays valid.
+            _rows[v] = std::move(row);
+            _expanded[v] = 1;
+        }
+        const std::vector<int>& row = _rows[v];
+        return IndexRange(row.data(), row.data() + row.size());
+    }
+
+    bool label(int ap, const std::string& name, int v) {
+        if (ap >= int(_labels.size())) {
+            _labels.resize(ap + 1);
+        }
+        // 0 if not evaluated yet, else 1 + the label.
+        std::vector<char>& known = _labels[ap];
+        if (v >= int(known.size())) {
+            known.resize(_states.size(), 0);
+        }
+        if (known[v] == 0) {
+            known[v] = 1 + _model->label(_states.state(v), name);
+        }
+        return known[v] == 2;
+    }
+
+    void initial_states(std::vector<int>& result) {
+        _buffer.clear();
+        _model->initial_states(_buffer);
+        for (State s : _buffer) {
+            result.push_back(index(s));
+        }
+    }
+
+   private:
+    const ImplicitModel* _model;
+    std::size_t _max_states;
+    StateStore _states;
+    std::deque<std::vector<int>> _rows;
+    std::vector<char> _expanded;
+    std::vector<std::vector<char>> _labels;
+    std::vector<State> _buffer;
+};
+
+// Checks formulas on an ImplicitModel without building its state graph: a
+// BasicLocalChecker whose searches generate the successors and labels of a
+// state only once they reach it. Only the states that the verdicts need are
+// ever numbered, in states(). Fairness constraints are not supported; use
+// ExploredModel with an explicit check for whole satisfaction sets.
+class OnTheFlyChecker : public BasicLocalChecker<_ImplicitGraph> {
+   public:
+    typedef ImplicitModel::State State;
+
+    // Throws if the searches reach more than `max_states` states (0 for no
+    // limit).
+    OnTheFlyChecker(const ImplicitModel& model, FormulaTable& formulas,
+                    std::size_t max_states = 0)
+        : BasicLocalChecker(_ImplicitGraph(model, max_states), formulas) {}
+
+    // Value of formula `id` in the model state s.
+    bool holds_at(int id, State s) { return holds(id, _graph.index(s)); }
+
+    const StateStore& states() const { return _graph.states(); }
+};
+
+// Decides whether `formula` holds in every initial state of `model`,
+// generating only the states needed for the verdict.
+inline bool modelcheck_initial(const ImplicitModel& model,
+                               std::shared_ptr<Formula> formula,
+                               std::size_t max_states = 0) {
+    FormulaTable formulas;
+    int id = formulas.intern(formula);
+    OnTheFlyChecker checker(model, formulas, max_states);
+    return checker.holds_initially(id);
+}
+
+// The part of an ImplicitModel reachable from its initial states, as a
+// Kripke structure whose state ids are the dense indices of states(): the
+// eager counterpart of OnTheFlyChecker, for whole satisfaction sets and the
+// explicit engines. States are explored breadth-first, so each row of the
+// transition graph is complete when it is appended and the CSR arrays are
+// built in place. An AP is evaluated on the explored states only once a
+// formula mentions it. Fairness constraints are not supported: modelcheck
+// below checks without them.
+class ExploredModel {
+   public:
+    typedef ImplicitModel::State State;
+
+    // Throws if more than `max_states` states (0 for no limit) are reachable.
+    explicit ExploredModel(const ImplicitModel& model,
+                           std::size_t max_states = 0)
+        : _model(model) {
+        std::vector<State> buffer;
+        std::unordered_set<int> S0;
+        model.initial_states(buffer);
+        bool inserted;
+        for (State s : buffer) {
+            S0.insert(_states.insert(s, inserted));
+        }
+
+        std::vector<std::size_t> offsets{0};
+        std::vector<int> targets;
+        for (int v = 0; v < _states.size(); v++) {
+            buffer.clear();
+            model.successors(_states.state(v), buffer);
+            std::size_t row = targets.size();
+            for (State s : buffer) {
+                targets.push_back(_states.insert(s, inserted));
+            }
+            if (max_states != 0 && std::size_t(_states.size()) > max_states) {
+                throw std::runtime_error("More than " +
+                                         std::to_string(max_states) +
+                                         " reachable states");
+            }
+            std::sort(targets.begin() + row, targets.end());
+            targets.erase(std::unique(targets.begin() + row, targets.end()),
+                          targets.end());
+            offsets.push_back(targets.size());
+        }
+
+        std::vector<int> ids(_states.size());
+        for (int v = 0; v < _states.size(); v++) {
+            ids[v] = v;
+        }
+        _kripke.reset(new Kripke(
+            CSRGraph(std::move(ids), std::move(offsets), std::move(targets)),
+            S0, {}, {}));
+    }
+
+    Kripke& kripke() { return *_kripke; }
+
+    const StateStore& states() const { return _states; }
+
+    // Labels the explored states with every AP of `formulas` not seen yet.
+    void label_aps(const FormulaTable& formulas) {
+        for (int a = 0; a < formulas.num_aps(); a++) {
+            const std::string& ap = formulas.ap_name(a);
+            if (_kripke->ap_states(ap) != nullptr) {
+                continue;
+            }
+            StateSet S(_states.size());
+            for (int v = 0; v < _states.size(); v++) {
+                if (_model.label(_states.state(v), ap)) {
+                    S.insert(v);
+                }
+            }
+            _kripke->set_ap_states(ap, std::move(S));
+        }
+    }
+
+   private:
+    const ImplicitModel& _model;
+    StateStore _states;
+    std::unique_ptr<Kripke> _kripke;
+};
+
+// Checks `formula` on the reachable part of an implicit model. Results in L
+// range over the dense indices of model.states().
+inline int modelcheck(ExploredModel& model, std::shared_ptr<Formula> formula,
+                      Labelling& L) {
+    L.formulas.intern(formula);
+    model.label_aps(L.formulas);
+    std::vector<std::unordered_set<int>> F;
+    return modelcheck(model.kripke(), formula, L, F);
+}
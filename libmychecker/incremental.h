@@ -0,0 +1,434 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "checker.h"
+#include "graph.h"
+#include "kripke.h"
+#include "stateset.h"
+
+// States that may have changed membership in a satisfaction set during an
+// update. Only states that existed before the edits are listed, since added
+// states are always evaluated; `all` means any state may have changed.
+struct _Change {
+    bool all = false;
+    std::vector<int> states;
+};
+
+// Brings a Labelling up to date with the journal of its Kripke structure.
+// Subformulas are updated bottom-up, each from the changes of its operands:
+// Not and Or pointwise, EX at the predecessors of changed states and the
+// tails of new edges. As long as the operands of EU and EG have only gained
+// states, their fixpoints only grow: EU is extended by propagating backwards
+// from the new goal states and from new edges into the old result, and EG by
+// searching for new cycles from the new edges and operand states. Otherwise
+// (and for results with witnesses, or under fairness, where the fair states
+// change as well) the fixpoint is recomputed.
+class _Recheck {
+   public:
+    _Recheck(Kripke& kripke, Labelling& L)
+        : _kripke(kripke),
+          _L(L),
+          _G(kripke.csr()),
+          _pre(kripke.predecessors()),
+          _old(kripke.changes().num_states),
+          _n(_G.size()),
+          _relabelled(kripke.changes().relabelled),
+          _fair(!L.fairness.empty()) {
+        for (const auto& edge : kripke.changes().edges) {
+            _edges.emplace_back(_G.index(edge.first), _G.index(edge.second));
+        }
+        const std::vector<std::string>& aps = kripke.atomic_propositions();
+        for (const auto& label : kripke.changes().labels) {
+            if (label.second < _old) {
+                _labels[aps[label.first]].push_back(label.second);
+            }
+        }
+        _changes.resize(L.formulas.size());
+        _done.resize(L.formulas.size(), 0);
+    }
+
+    void run() {
+        for (int id = 0; id < _L.formulas.size(); id++) {
+            if (_L.contains(id)) {
+                update(id);
+            }
+        }
+    }
+
+   private:
+    Kripke& _kripke;
+    Labelling& _L;
+    const CSRGraph& _G;
+    const CSRGraph& _pre;
+    int _old;
+    int _n;
+    bool _relabelled;
+    bool _fair;
+    std::vector<std::pair<int, int>> _edges;
+    std::unordered_map<std::string, std::vector<int>> _labels;
+    std::vector<_Change> _changes;
+    std::vector<char> _done;
+
+    const _Change& update(int id) {
+        if (!_done[id] && !_L.contains(id)) {
+            // The result was released to save memory: check it afresh from
+            // updated operands, without releasing the results still being
+            // updated.
+            EvaluationPlan plan = compile_plan(_L.formulas, {id});
+            for (const PlanStep& step : plan.steps) {
+                if (_L.contains(step.slot)) {
+                    update(step.slot);
+                }
+            }
+            std::size_t budget = _L.options.memory_budget;
+            _L.options.memory_budget = 0;
+            _checkStateFormula(_kripke, id, _L);
+            _L.options.memory_budget = budget;
+            _changes[id].all = true;
+            _done[id] = 1;
+        }
+        if (!_done[id]) {
+            _Change c = _update(id);
+            _changes[id] = std::move(c);
+            _done[id] = 1;
+        }
+        return _changes[id];
+    }
+
+    _Change _update(int id) {
+        _Change c;
+        if (!_L.formulas.is_restricted(id)) {
+            int rid = _L.formulas.restricted(id);
+            c = update(rid);
+            _L.alias(id, rid);
+            return c;
+        }
+
+        const FormulaNode& node = _L.formulas.node(id);
+        int left = node.left;
+        int right = node.right;
+        switch (node.opcode) {
+            case (OpCode::Bool): {
+                _L.set(id, StateSet(_n, node.ap));
+                return c;
+            }
+            case (OpCode::Atomic): {
+                const std::string& ap = _L.formulas.ap_name(node.ap);
+                const StateSet* S = _kripke.ap_states(ap);
+                if (S == nullptr) {
+                    _L.set(id, StateSet(_n));
+                } else if (_fair) {
+                    StateSet old = _resized(id);
+                    _L.set(id, *S & _L.fair);
+                    _diff(old, _L[id], c);
+                } else if (_relabelled) {
+                    c.all = true;
+                    _L.borrow(id, *S);
+                } else if (&_L[id] != S) {
+                    // The AP was unknown when id was checked.
+                    S->for_each([&](int v) {
+                        if (v < _old) {
+                            c.states.push_back(v);
+                        }
+                    });
+                    _L.borrow(id, *S);
+                } else {
+                    auto found = _labels.find(ap);
+                    if (found != _labels.end()) {
+                        c.states = found->second;
+                    }
+                }
+                return c;
+            }
+            case (OpCode::Not): {
+                c = update(left);
+                _L.set(id, ~_L[left]);
+                return c;
+            }
+            case (OpCode::Or): {
+                const _Change& l = update(left);
+                const _Change& r = update(right);
+                StateSet old = _L[id];
+                _L.set(id, _L[left] | _L[right]);
+                if (l.all || r.all) {
+                    _diff(old, _L[id], c);
+                } else {
+                    _flipped(old, _L[id], l.states, c);
+                    _flipped(old, _L[id], r.states, c);
+                }
+                return c;
+            }
+            case (OpCode::E): {
+                const FormulaNode& path = _L.formulas.node(left);
+                switch (path.opcode) {
+                    case (OpCode::X): {
+                        return _updateEX(id, path.left);
+                    }
+                    case (OpCode::U): {
+                        return _updateEU(id, path.left, path.right);
+                    }
+                    case (OpCode::G): {
+                        return _updateEG(id, path.left);
+                    }
+                }
+            }
+        }
+        throw std::runtime_error(_L.formulas.str(id) +
+                                 " is not in the restricted basis");
+    }
+
+    // Records the states of [0, _old) whose membership differs in a and b.
+    void _diff(const StateSet& a, const StateSet& b, _Change& c) const {
+        std::size_t words = (std::size_t(_old) + 63) / 64;
+        for (std::size_t i = 0; i < words; i++) {
+            std::uint64_t flipped = a.data()[i] ^ b.data()[i];
+            while (flipped != 0) {
+                int v = 64 * i + __builtin_ctzll(flipped);
+                if (v < _old) {
+                    c.states.push_back(v);
+                }
+                flipped &= flipped - 1;
+            }
+        }
+    }
+
+    // Records the states of `candidates` whose membership differs in a and b.
+    static void _flipped(const StateSet& a, const StateSet& b,
+                         const std::vector<int>& candidates, _Change& c) {
+        for (int v : candidates) {
+            if (a.contains(v) != b.contains(v)) {
+                c.states.push_back(v);
+            }
+        }
+    }
+
+    // Whether the operand `id` has only gained states.
+    bool _grown(int id) {
+        const _Change& c = update(id);
+        if (c.all) {
+            return false;
+        }
+        for (int v : c.states) {
+            if (!_L[id].contains(v)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    StateSet _resized(int id) const {
+        StateSet S = _L[id];
+        S.resize(_n);
+        return S;
+    }
+
+    _Change _recompute(int id, void (*check)(Kripke&, int, Labelling&)) {
+        _Change c;
+        StateSet old = _resized(id);
+        check(_kripke, id, _L);
+        _diff(old, _L[id], c);
+        return c;
+    }
+
+    _Change _updateEX(int id, int phi) {
+        const _Change& changed = update(phi);
+        if (changed.all || _fair) {
+            return _recompute(id, _checkEX);
+        }
+
+        std::vector<int> candidates;
+        for (int w : changed.states) {
+            for (int v : _pre.successors(w)) {
+                candidates.push_back(v);
+            }
+        }
+        for (const auto& edge : _edges) {
+            candidates.push_back(edge.first);
+        }
+
+        _Change c;
+        StateSet S = _resized(id);
+        const StateSet& in_phi = _L[phi];
+        for (int v : candidates) {
+            bool value = false;
+            for (int w : _G.successors(v)) {
+                if (in_phi.contains(w)) {
+                    value = true;
+                    break;
+                }
+            }
+            if (value != S.contains(v)) {
+                if (value) {
+                    S.insert(v);
+                } else {
+                    S.erase(v);
+                }
+                if (v < _old) {
+                    c.states.push_back(v);
+                }
+            }
+        }
+        _L.set(id, std::move(S));
+        return c;
+    }
+
+    // States where a fixpoint may have to grow: tails of new edges, added
+    // states, and states that newly satisfy `phi`.
+    void _sources(int phi, std::vector<int>& result) {
+        for (const auto& edge : _edges) {
+            result.push_back(edge.first);
+        }
+        for (int v = _old; v < _n; v++) {
+            result.push_back(v);
+        }
+        const std::vector<int>& grown = update(phi).states;
+        result.insert(result.end(), grown.begin(), grown.end());
+    }
+
+    // Adds to Z every phi-state with a path through phi-states to a state
+    // of `queue`, and appends the added states to `queue`.
+    void _propagate(const StateSet& in_phi, StateSet& Z,
+                    std::vector<int>& queue, std::size_t first) {
+        for (std::size_t i = first; i < queue.size(); i++) {
+            int v = queue[i];
+            for (int t : _pre.successors(v)) {
+                if (in_phi.contains(t) && Z.test_and_insert(t)) {
+                    queue.push_back(t);
+                }
+            }
+        }
+    }
+
+    _Change _updateEU(int id, int phi, int chi) {
+        bool grown = _grown(phi);
+        grown = _grown(chi) && grown;
+        if (!grown || _L.options.witnesses || _fair) {
+            return _recompute(id, _checkEU);
+        }
+
+        StateSet Z = _resized(id);
+        const StateSet& in_phi = _L[phi];
+        const StateSet& in_chi = _L[chi];
+        std::vector<int> queue;
+        auto add = [&](int v) {
+            if (Z.test_and_insert(v)) {
+                queue.push_back(v);
+            }
+        };
+        for (int v : update(chi).states) {
+            add(v);
+        }
+        for (int v = _old; v < _n; v++) {
+            if (in_chi.contains(v)) {
+                add(v);
+            }
+        }
+        std::vector<int> sources;
+        _sources(phi, sources);
+        for (int v : sources) {
+            if (!in_phi.contains(v) || Z.contains(v)) {
+                continue;
+            }
+            for (int w : _G.successors(v)) {
+                if (Z.contains(w)) {
+                    add(v);
+                    break;
+                }
+            }
+        }
+        _propagate(in_phi, Z, queue, 0);
+
+        _Change c;
+        for (int v : queue) {
+            if (v < _old) {
+                c.states.push_back(v);
+            }
+        }
+        _L.set(id, std::move(Z));
+        return c;
+    }
+
+    // A new infinite phi-path must use a new edge or state, or a state that
+    // newly satisfies phi; so it suffices to search from those for a cycle or
+    // the old result. A search that fails proves every state it finished
+    // dead, i.e. without an infinite phi-path.
+    _Change _updateEG(int id, int phi) {
+        if (!_grown(phi) || _L.options.witnesses || _fair) {
+            return _recompute(id, _checkEG);
+        }
+
+        StateSet Z = _resized(id);
+        const StateSet& in_phi = _L[phi];
+        StateSet dead(_n);
+        StateSet on_stack(_n);
+        std::vector<int> queue;
+        std::vector<std::pair<int, const int*>> stack;
+        std::vector<int> sources;
+        _sources(phi, sources);
+        for (int x : sources) {
+            if (!in_phi.contains(x) || Z.contains(x) || dead.contains(x)) {
+                continue;
+            }
+            bool found = false;
+            stack.emplace_back(x, _G.successors(x).begin());
+            on_stack.insert(x);
+            while (!found && !stack.empty()) {
+                std::pair<int, const int*>& top = stack.back();
+                if (top.second == _G.successors(top.first).end()) {
+                    on_stack.erase(top.first);
+                    dead.insert(top.first);
+                    stack.pop_back();
+                    continue;
+                }
+                int w = *top.second++;
+                if (!in_phi.contains(w) || dead.contains(w)) {
+                    continue;
+                }
+                if (Z.contains(w) || on_stack.contains(w)) {
+                    found = true;
+                } else {
+                    stack.emplace_back(w, _G.successors(w).begin());
+                    on_stack.insert(w);
+                }
+            }
+            std::size_t first = queue.size();
+            for (const auto& entry : stack) {
+                on_stack.erase(entry.first);
+                if (Z.test_and_insert(entry.first)) {
+                    queue.push_back(entry.first);
+                }
+            }
+            stack.clear();
+            _propagate(in_phi, Z, queue, first);
+        }
+
+        _Change c;
+        for (int v : queue) {
+            if (v < _old) {
+                c.states.push_back(v);
+            }
+        }
+        _L.set(id, std::move(Z));
+        return c;
+    }
+};
+
+// Updates every result in L after edits of `kripke` (new states, edges and
+// labels), recomputing only what the edits can affect, and clears the
+// journal of `kripke`. L must have been filled for this structure by the
+// Explicit engine. Added states belong to no fairness set.
+inline void recheck(Kripke& kripke, Labelling& L) {
+    if (!L.fairness.empty()) {
+        int n = kripke.csr().size();
+        for (StateSet& P : L.fairness) {
+            P.resize(n);
+        }
+        L.fair = _EG(kripke, StateSet(n, true), L, nullptr);
+    }
+    _Recheck(kripke, L).run();
+    kripke.clear_changes();
+}
@@ -1,101 +1,379 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <deque>
 #include <iostream>
+#include <memory>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "graph.h"
+#include "parallel_scc.h"
+#include "stateset.h"
+
+// Edits of a Kripke structure since its journal was last cleared. States
+// with a dense index of at least num_states were added since; `labels` lists
+// the (AP id, dense index) pairs whose membership was flipped, and
+// `relabelled` is set once the whole labelling has been replaced.
+struct KripkeChanges {
+    int num_states = 0;
+    std::vector<std::pair<int, int>> edges;
+    std::vector<std::pair<int, int>> labels;
+    bool relabelled = false;
+};
 
+// Labels are stored column-wise: every atomic proposition is interned to an
+// id and owns one StateSet over the dense indices of csr(). Dense indices are
+// stable: states added to an existing structure are appended after the
+// current ones. Edits are journaled in changes() for incremental re-checking.
 class Kripke : public DiGraph {
    public:
     Kripke(const std::unordered_set<int>& S, const std::unordered_set<int>& S0,
            const std::vector<std::pair<int, int>>& R,
            std::unordered_map<int, std::unordered_set<std::string>> L)
-        : DiGraph(S, R), S0(S0) {
-        std::vector<int> vecN;
-        nodes(vecN);
-        for (int state : vecN) {
-            if (L.find(state) != L.end()) {
-                _labels[state] = L[state];
-            } else {
-                _labels[state] = std::unordered_set<std::string>();
+        : DiGraph(S, R), S0(S0), _thawed(true) {
+        DiGraph::nodes(_order);
+        std::sort(_order.begin(), _order.end());
+        set_labels(L);
+        _changes.num_states = _order.size();
+    }
+
+    // Builds a frozen Kripke structure directly on a CSR graph; the hash-based
+    // DiGraph view stays empty until thaw() is called.
+    Kripke(CSRGraph G, const std::unordered_set<int>& S0,
+           std::unordered_map<int, std::unordered_set<std::string>> L)
+        : DiGraph({}, {}),
+          S0(S0),
+          _csr(std::make_shared<const CSRGraph>(std::move(G))),
+          _thawed(false) {
+        set_labels(L);
+        _changes.num_states = _csr->size();
+    }
+
+    // As above, with labels given as one StateSet over the dense indices of
+    // G per atomic proposition.
+    Kripke(CSRGraph G, const std::unordered_set<int>& S0,
+           std::vector<std::string> aps, std::vector<StateSet> columns)
+        : DiGraph({}, {}),
+          S0(S0),
+          _csr(std::make_shared<const CSRGraph>(std::move(G))),
+          _thawed(false) {
+        if (aps.size() != columns.size()) {
+            throw std::runtime_error("Expected one label set per AP");
+        }
+        for (std::size_t a = 0; a < aps.size(); a++) {
+            if (columns[a].size() != _csr->size()) {
+                throw std::runtime_error("Label set of " + aps[a] +
+                                         " has the wrong size");
             }
+            StateSet& column = intern_ap(aps[a]);
+            column = std::move(columns[a]);
+        }
+        _changes.num_states = _csr->size();
+    }
+
+    const CSRGraph& csr() const {
+        if (!_csr) {
+            _csr = std::make_shared<const CSRGraph>(*this, _order);
+        }
+        return *_csr;
+    }
+
+    // Reverse adjacency over the same dense indices as csr(); built on first
+    // use and kept until the structure changes.
+    const CSRGraph& predecessors() const {
+        if (!_pre) {
+            _pre = std::make_shared<const CSRGraph>(csr().reversed());
+        }
+        return *_pre;
+    }
+
+    // SCC decomposition and condensation of csr(), computed with `options`
+    // on first use and kept until the structure changes.
+    const Condensation& condensation(
+        const SCCOptions& options = SCCOptions()) const {
+        if (!_condensation) {
+            SCCDecomposition sccs;
+            compute_SCCs(csr(), predecessors(), sccs, options);
+            auto C = std::make_shared<Condensation>();
+            condense(csr(), sccs, *C);
+            _condensation = std::move(C);
+        }
+        return *_condensation;
+    }
+
+    bool has_condensation() const { return bool(_condensation); }
+
+    // Approximate heap bytes of the structure: its adjacency while thawed,
+    // the label sets, and the CSR, reverse and SCC caches built so far.
+    std::size_t bytes() const {
+        std::size_t total = DiGraph::bytes() + _order.capacity() * sizeof(int);
+        for (const StateSet& column : _columns) {
+            total += column.bytes();
+        }
+        if (_csr) {
+            total += _csr->bytes();
+        }
+        if (_pre) {
+            total += _pre->bytes();
+        }
+        if (_condensation) {
+            total += _condensation->bytes();
+        }
+        return total;
+    }
+
+    // Dense indices of the states reachable from those of `from`, including
+    // themselves. A state reaches its whole SCC, so the search runs on the
+    // condensation.
+    StateSet reachable(const StateSet& from) const {
+        const Condensation& C = condensation();
+        std::vector<char> reached(C.sccs.size(), 0);
+        from.for_each([&](int v) { reached[C.component[v]] = 1; });
+        // Successor components have smaller ids.
+        for (int k = C.sccs.size() - 1; k >= 0; k--) {
+            if (reached[k]) {
+                for (int j : C.dag.successors(k)) {
+                    reached[j] = 1;
+                }
+            }
+        }
+        StateSet result(csr().size());
+        for (int v = 0; v < result.size(); v++) {
+            if (reached[C.component[v]]) {
+                result.insert(v);
+            }
+        }
+        return result;
+    }
+
+    // Converts the structure to its CSR form and releases the hash-based
+    // adjacency.
+    void freeze() {
+        csr();
+        _next.clear();
+        _order.clear();
+        _thawed = false;
+    }
+
+    void thaw() {
+        if (!_thawed) {
+            _next = _csr->to_digraph()._next;
+            _order.assign(_csr->ids().begin(), _csr->ids().end());
+            _thawed = true;
+        }
+    }
+
+    void add_node(const int v) {
+        thaw();
+        DiGraph::add_node(v);
+        append(v);
+    }
+
+    void add_edge(const int src, const int dst) {
+        thaw();
+        if (_next.find(src) == _next.end()) {
+            add_node(src);
+        }
+        if (_next.find(dst) == _next.end()) {
+            add_node(dst);
+        }
+        DiGraph::add_edge(src, dst);
+        _changes.edges.emplace_back(src, dst);
+        _csr.reset();
+        _pre.reset();
+        _condensation.reset();
+    }
+
+    const KripkeChanges& changes() const { return _changes; }
+
+    // Starts a new journal at the current states.
+    void clear_changes() {
+        _changes = KripkeChanges();
+        _changes.num_states = _thawed ? int(_order.size()) : _csr->size();
+    }
+
+    // The interned atomic propositions; the id of an AP is its position.
+    const std::vector<std::string>& atomic_propositions() const {
+        return _ap_names;
+    }
+
+    // The states labelled with `ap`, or nullptr if no state ever was. The
+    // pointer stays valid until the labelling is replaced.
+    const StateSet* ap_states(const std::string& ap) const {
+        auto found = _ap_ids.find(ap);
+        if (found == _ap_ids.end()) {
+            return nullptr;
+        }
+        return &_columns[found->second];
+    }
+
+    // Replaces the set of states labelled with `ap`.
+    void set_ap_states(const std::string& ap, StateSet S) {
+        if (S.size() != (_thawed ? int(_order.size()) : _csr->size())) {
+            throw std::runtime_error("Label set of " + ap +
+                                     " has the wrong size");
+        }
+        StateSet& column = intern_ap(ap);
+        int a = _ap_ids[ap];
+        for (std::size_t i = 0; i < S.num_words(); i++) {
+            std::uint64_t flipped = column.data()[i] ^ S.data()[i];
+            while (flipped != 0) {
+                int v = 64 * i + __builtin_ctzll(flipped);
+                _changes.labels.emplace_back(a, v);
+                flipped &= flipped - 1;
+            }
+        }
+        column = std::move(S);
+    }
+
+    void add_label(int state, const std::string& ap) {
+        int v = csr().index(state);
+        if (intern_ap(ap).test_and_insert(v)) {
+            _changes.labels.emplace_back(_ap_ids[ap], v);
         }
     }
 
     std::unordered_map<int, std::unordered_set<std::string>>
     labelling_function() const {
-        return _labels;
+        const CSRGraph& G = csr();
+        std::unordered_map<int, std::unordered_set<std::string>> L;
+        for (int v = 0; v < G.size(); v++) {
+            L[G.id(v)];
+        }
+        for (std::size_t a = 0; a < _columns.size(); a++) {
+            _columns[a].for_each(
+                [&](int v) { L[G.id(v)].insert(_ap_names[a]); });
+        }
+        return L;
     }
 
     std::unordered_map<int, std::unordered_set<std::string>>
     replace_labelling_function(
         const std::unordered_map<int, std::unordered_set<std::string>>& L) {
-        auto old_L = _labels;
-        _labels = L;
-        std::vector<int> vecS;
-        states(vecS);
-
-        for (int s : vecS) {
-            if (_labels.find(s) == _labels.end()) {
-                _labels[s] = std::unordered_set<std::string>();
-            }
-        }
-
+        auto old_L = labelling_function();
+        _ap_names.clear();
+        _ap_ids.clear();
+        _columns.clear();
+        set_labels(L);
+        _changes.relabelled = true;
         return old_L;
     }
 
     std::unordered_set<std::string> labels(int state = -1) const {
         if (state != -1) {
-            if (_next.find(state) == _next.end()) {
+            const CSRGraph& G = csr();
+            if (!G.contains(state)) {
                 throw std::runtime_error(
                     "State not found in the Kripke structure");
             }
-            return _labels.at(state);
-        }
-
-        std::unordered_set<std::string> AP;
-        for (const auto& ap : _labels) {
-            AP.insert(ap.second.begin(), ap.second.end());
+            int v = G.index(state);
+            std::unordered_set<std::string> result;
+            for (std::size_t a = 0; a < _columns.size(); a++) {
+                if (_columns[a].contains(v)) {
+                    result.insert(_ap_names[a]);
+                }
+            }
+            return result;
         }
 
-        return AP;
+        return std::unordered_set<std::string>(_ap_names.begin(),
+                                               _ap_names.end());
     }
 
-    void states(std::vector<int>& result) const { return nodes(result); }
+    const std::unordered_set<int>& initial_states() const { return S0; }
+
+    void states(std::vector<int>& result) const {
+        const CSRGraph& G = csr();
+        result.insert(result.end(), G.ids().begin(), G.ids().end());
+    }
 
     void next(int src, std::unordered_set<int>& result) const {
-        try {
-            return DiGraph::next(src, result);
-        } catch (const std::exception&) {
+        const CSRGraph& G = csr();
+        if (!G.contains(src)) {
             throw std::runtime_error(
                 "Source state not found in the Kripke structure");
         }
+        result.clear();
+        for (int w : G.successors(G.index(src))) {
+            result.insert(G.id(w));
+        }
     }
 
     void transitions(std::vector<std::pair<int, int>>& result) const {
-        return edges(result);
+        const CSRGraph& G = csr();
+        result.reserve(result.size() + G.num_edges());
+        for (int v = 0; v < G.size(); v++) {
+            for (int w : G.successors(v)) {
+                result.push_back(std::make_pair(G.id(v), G.id(w)));
+            }
+        }
     }
 
-    // std::vector<std::pair<int, int>> transitions_iter() const {
-    //    return edges_iter();
-    // }
+    // The DiGraph queries, answered from csr() like states(), next() and
+    // transitions(): a frozen structure keeps no hash-based adjacency.
+    void nodes(std::vector<int>& result) const { states(result); }
 
-    Kripke clone() const {
-        std::unordered_map<int, std::unordered_set<std::string>> L;
-        for (const auto& entry : _labels) {
-            L[entry.first] = entry.second;
+    void edges(std::vector<std::pair<int, int>>& result) const {
+        transitions(result);
+    }
+
+    void sources(std::unordered_set<int>& result) const {
+        const CSRGraph& G = csr();
+        for (int v = 0; v < G.size(); v++) {
+            if (!G.successors(v).empty()) {
+                result.insert(G.id(v));
+            }
         }
+    }
 
-        std::vector<int> vecS;
-        states(vecS);
-        std::unordered_set<int> setS(vecS.begin(), vecS.end());
-        std::vector<std::pair<int, int>> T;
-        transitions(T);
+    DiGraph get_subgraph(const std::unordered_set<int>& nodes) const {
+        return csr().to_digraph().get_subgraph(nodes);
+    }
 
-        return Kripke(setS, S0, T, L);
+    DiGraph get_reversed_graph() const {
+        return predecessors().to_digraph();
     }
 
+    std::unordered_set<int> get_reachable_set_from(
+        const std::unordered_set<int>& nodes) const {
+        const CSRGraph& G = csr();
+        StateSet R(G.size());
+        std::vector<int> queue;
+        for (int s : nodes) {
+            if (!G.contains(s)) {
+                throw std::runtime_error(
+                    "Source state not found in the Kripke structure");
+            }
+            if (R.test_and_insert(G.index(s))) {
+                queue.push_back(G.index(s));
+            }
+        }
+        while (!queue.empty()) {
+            int v = queue.back();
+            queue.pop_back();
+            for (int w : G.successors(v)) {
+                if (R.test_and_insert(w)) {
+                    queue.push_back(w);
+                }
+            }
+        }
+        std::unordered_set<int> result;
+        R.for_each([&](int v) { result.insert(G.id(v)); });
+        return result;
+    }
+
+    std::string to_string() const { return csr().to_digraph().to_string(); }
+
+    // std::vector<std::pair<int, int>> transitions_iter() const {
+    //    return edges_iter();
+    // }
+
+    // The CSR form is immutable, so clones share it.
+    Kripke clone() const { return *this; }
+
     Kripke get_substructure(const std::unordered_set<int>& V) const {
         std::vector<int> vecS;
         states(vecS);
@@ -126,46 +404,56 @@ class Kripke : public DiGraph {
         }
 
         std::unordered_map<int, std::unordered_set<std::string>> L;
-        for (const auto& entry : _labels) {
-            if (S.find(entry.first) != S.end()) {
-                L[entry.first] = entry.second;
-            }
+        for (int s : S) {
+            L[s] = labels(s);
         }
 
         return Kripke(S, S0_sub, E, L);
     }
 
     std::unordered_set<int> get_fair_states(
-        const std::vector<std::unordered_set<int>>& F) const {
-        std::unordered_set<int> F_set;
-        std::vector<std::unordered_set<int>> sccs;
-        compute_SCCs(*this, sccs);
-        for (const auto& SCC : sccs) {
-            if (is_a_fair_SCC(SCC, F)) {
-                F_set.insert(SCC.begin(), SCC.end());
+        const std::vector<std::unordered_set<int>>& F,
+        const SCCOptions& options = SCCOptions()) const {
+        const CSRGraph& G = csr();
+        std::unordered_set<int> result;
+        fair_states(F, options).for_each(
+            [&](int v) { result.insert(G.id(v)); });
+        return result;
+    }
+
+    // Dense indices of the states from which a path through a fair SCC
+    // starts, decided per component of the condensation.
+    StateSet fair_states(const std::vector<std::unordered_set<int>>& F,
+                         const SCCOptions& options = SCCOptions()) const {
+        const Condensation& C = condensation(options);
+        std::vector<char> fair(C.sccs.size(), 0);
+        // Successor components have smaller ids, so they are decided first.
+        for (int k = 0; k < C.sccs.size(); k++) {
+            fair[k] = is_a_fair_SCC(C.sccs[k], F);
+            for (int j : C.dag.successors(k)) {
+                fair[k] = fair[k] || fair[j];
             }
         }
-
-        DiGraph R_graph = get_reversed_graph();
-
-        return R_graph.get_reachable_set_from(F_set);
+        StateSet reached(csr().size());
+        for (int v = 0; v < reached.size(); v++) {
+            if (fair[C.component[v]]) {
+                reached.insert(v);
+            }
+        }
+        return reached;
     }
 
     std::string label_fair_states(
-        const std::vector<std::unordered_set<int>>& F) {
+        const std::vector<std::unordered_set<int>>& F,
+        const SCCOptions& options = SCCOptions()) {
         std::string f_label = "fair";
         int i = 0;
-        std::unordered_set<std::string> aps = labels();
-        while (aps.find(f_label) != aps.end()) {
+        while (_ap_ids.find(f_label) != _ap_ids.end()) {
             f_label = "fair" + std::to_string(i);
             i++;
         }
 
-        std::unordered_set<int> fair_states = get_fair_states(F);
-        for (int s : fair_states) {
-            _labels[s].insert(f_label);
-        }
-
+        set_ap_states(f_label, fair_states(F, options));
         return f_label;
     }
 
@@ -179,25 +467,69 @@ class Kripke : public DiGraph {
 
    private:
     std::unordered_set<int> S0;
-    std::unordered_map<int, std::unordered_set<std::string>> _labels;
+    std::vector<std::string> _ap_names;
+    std::unordered_map<std::string, int> _ap_ids;
+    // A deque, so that pointers returned by ap_states() survive new APs.
+    std::deque<StateSet> _columns;
+    // Dense order of the nodes while the structure is thawed.
+    std::vector<int> _order;
+    mutable std::shared_ptr<const CSRGraph> _csr;
+    mutable std::shared_ptr<const CSRGraph> _pre;
+    mutable std::shared_ptr<const Condensation> _condensation;
+    bool _thawed;
+    KripkeChanges _changes;
+
+    StateSet& intern_ap(const std::string& ap) {
+        auto found = _ap_ids.find(ap);
+        if (found != _ap_ids.end()) {
+            return _columns[found->second];
+        }
+        _ap_ids.emplace(ap, _ap_names.size());
+        _ap_names.push_back(ap);
+        _columns.emplace_back(_thawed ? int(_order.size()) : _csr->size());
+        return _columns.back();
+    }
+
+    void set_labels(
+        const std::unordered_map<int, std::unordered_set<std::string>>& L) {
+        const CSRGraph& G = csr();
+        for (const auto& entry : L) {
+            if (!G.contains(entry.first)) {
+                continue;
+            }
+            int v = G.index(entry.first);
+            for (const std::string& ap : entry.second) {
+                intern_ap(ap).insert(v);
+            }
+        }
+    }
+
+    void append(int v) {
+        _order.push_back(v);
+        for (StateSet& column : _columns) {
+            column.resize(_order.size());
+        }
+        _csr.reset();
+        _pre.reset();
+        _condensation.reset();
+    }
 
-    bool is_a_fair_SCC(const std::unordered_set<int>& scc,
+    bool is_a_fair_SCC(IndexRange scc,
                        const std::vector<std::unordered_set<int>>& F) const {
-        int v = *(scc.begin());
-        std::unordered_set<int> next_v;
-        next(v, next_v);
-        if (scc.size() == 1 || next_v.find(v) == next_v.end()) {
+        const CSRGraph& G = csr();
+        if (!is_nontrivial_SCC(G, scc)) {
             return false;
         }
 
         for (const auto& P : F) {
-            std::unordered_set<int> tmp;
+            bool found = false;
             for (int i : scc) {
-                if (P.begin(i) != P.end()) {
-                    tmp.insert(i);
+                if (P.find(G.id(i)) != P.end()) {
+                    found = true;
+                    break;
                 }
             }
-            if (tmp.empty()) {
+            if (!found) {
                 return false;
             }
         }
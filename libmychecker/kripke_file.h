@@ -0,0 +1,309 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "graph.h"
+#include "kripke.h"
+
+// Binary Kripke file, version 2. Integers are stored in the byte order of
+// the writer, which byte_order records, and every section starts at a
+// multiple of 8 bytes:
+//
+//   header       KripkeFileHeader
+//   ids          int32[num_states]        state id of each dense index,
+//                                         strictly increasing
+//   offsets      uint64[num_states + 1]   CSR row offsets
+//   targets      int32[num_edges]         CSR targets, sorted per row
+//   ap_names     uint64[num_aps + 1]      offsets into the characters that
+//                char[]                   follow, one name per AP
+//   labels       uint64[num_aps][words]   one bitset over the dense indices
+//                                         per AP, words = (num_states+63)/64
+//   initial      int32[num_initial]       dense indices of initial states
+//
+// The CSR arrays are used in place from the mapping, so processes mapping
+// the same file share their pages, and since the ids are sorted they are
+// looked up by binary search without building an index. Opening a file
+// touches neither the edges nor the ids unless it is asked to validate
+// them. The label bitsets (num_aps * words words, small next to the edges)
+// are copied into the StateSet columns of the Kripke structure.
+static_assert(sizeof(std::size_t) == 8, "CSR offsets must be 64-bit");
+
+struct KripkeFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint64_t flags;
+    std::uint64_t num_states;
+    std::uint64_t num_edges;
+    std::uint64_t num_aps;
+    std::uint64_t num_initial;
+    std::uint64_t ids;
+    std::uint64_t offsets;
+    std::uint64_t targets;
+    std::uint64_t ap_names;
+    std::uint64_t labels;
+    std::uint64_t initial;
+    std::uint64_t file_size;
+};
+
+static constexpr char kripke_file_magic[8] = {'M', 'Y', 'C', 'H',
+                                              'K', 'R', 'P', 'K'};
+static constexpr std::uint32_t kripke_file_version = 2;
+static constexpr std::uint32_t kripke_file_byte_order = 0x01020304;
+
+// A read-only memory mapping of a whole file, unmapped on destruction.
+class MappedFile {
+   public:
+    explicit MappedFile(const std::string& path) : _data(nullptr), _size(0) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("Cannot stat " + path);
+        }
+        _size = st.st_size;
+        if (_size > 0) {
+            void* data = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+            if (data == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Cannot map " + path);
+            }
+            _data = static_cast<const char*>(data);
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (_data != nullptr) {
+            munmap(const_cast<char*>(_data), _size);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return _data; }
+    std::size_t size() const { return _size; }
+
+   private:
+    const char* _data;
+    std::size_t _size;
+};
+
+// Writes `kripke` with its states renumbered in increasing id order if they
+// are not already.
+inline void save_kripke(const Kripke& kripke, const std::string& path) {
+    const CSRGraph& G = kripke.csr();
+    const std::uint64_t n = G.size();
+    const std::uint64_t words = (n + 63) / 64;
+
+    // rank[v] is the index of state v in the file.
+    std::vector<int> order(n), rank;
+    for (std::uint64_t v = 0; v < n; v++) {
+        order[v] = v;
+    }
+    bool sorted = true;
+    for (std::uint64_t v = 1; v < n && sorted; v++) {
+        sorted = G.id(v - 1) < G.id(v);
+    }
+    std::vector<int> ids(G.ids().begin(), G.ids().end());
+    std::vector<std::size_t> offsets(G.offsets(), G.offsets() + n + 1);
+    std::vector<int> targets(G.targets(), G.targets() + G.num_edges());
+    if (!sorted) {
+        std::sort(order.begin(), order.end(),
+                  [&](int v, int w) { return G.id(v) < G.id(w); });
+        rank.resize(n);
+        for (std::uint64_t i = 0; i < n; i++) {
+            rank[order[i]] = i;
+            ids[i] = G.id(order[i]);
+        }
+        std::size_t e = 0;
+        for (std::uint64_t i = 0; i < n; i++) {
+            offsets[i] = e;
+            for (int w : G.successors(order[i])) {
+                targets[e++] = rank[w];
+            }
+            std::sort(targets.begin() + offsets[i], targets.begin() + e);
+        }
+        offsets[n] = e;
+    }
+
+    const std::vector<std::string>& names = kripke.atomic_propositions();
+    std::vector<std::uint64_t> labels;
+    labels.reserve(names.size() * words);
+    for (const std::string& name : names) {
+        const StateSet* S = kripke.ap_states(name);
+        if (sorted) {
+            labels.insert(labels.end(), S->data(), S->data() + words);
+            continue;
+        }
+        StateSet column(n);
+        S->for_each([&](int v) { column.insert(rank[v]); });
+        labels.insert(labels.end(), column.data(), column.data() + words);
+    }
+
+    std::vector<std::uint64_t> name_offsets{0};
+    std::string chars;
+    for (const std::string& name : names) {
+        chars += name;
+        name_offsets.push_back(chars.size());
+    }
+
+    std::vector<int> initial;
+    for (int s : kripke.initial_states()) {
+        initial.push_back(sorted ? G.index(s) : rank[G.index(s)]);
+    }
+    std::sort(initial.begin(), initial.end());
+
+    auto align = [](std::uint64_t x) { return (x + 7) / 8 * 8; };
+    KripkeFileHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, kripke_file_magic, sizeof(h.magic));
+    h.version = kripke_file_version;
+    h.byte_order = kripke_file_byte_order;
+    h.num_states = n;
+    h.num_edges = G.num_edges();
+    h.num_aps = names.size();
+    h.num_initial = initial.size();
+    h.ids = align(sizeof(h));
+    h.offsets = align(h.ids + 4 * n);
+    h.targets = h.offsets + 8 * (n + 1);
+    h.ap_names = align(h.targets + 4 * h.num_edges);
+    h.labels = align(h.ap_names + 8 * name_offsets.size() + chars.size());
+    h.initial = h.labels + 8 * labels.size();
+    h.file_size = align(h.initial + 4 * initial.size());
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    std::uint64_t pos = 0;
+    auto write = [&](std::uint64_t at, const void* data, std::size_t size) {
+        static const char zeros[8] = {0};
+        out.write(zeros, at - pos);
+        out.write(static_cast<const char*>(data), size);
+        pos = at + size;
+    };
+    write(0, &h, sizeof(h));
+    write(h.ids, ids.data(), 4 * n);
+    write(h.offsets, offsets.data(), 8 * (n + 1));
+    write(h.targets, targets.data(), 4 * h.num_edges);
+    write(h.ap_names, name_offsets.data(), 8 * name_offsets.size());
+    write(pos, chars.data(), chars.size());
+    write(h.labels, labels.data(), 8 * labels.size());
+    write(h.initial, initial.data(), 4 * initial.size());
+    write(h.file_size, nullptr, 0);
+    if (!out) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
+
+// Opens a file written by save_kripke. The transition graph of the result
+// borrows the mapped CSR arrays, which stay mapped as long as the graph (or
+// any copy of it) is alive; label sets are copied word by word. Throws if
+// the file is truncated or its header, AP names or initial states are
+// corrupt. Only if `validate` are the ids, row offsets and targets read as
+// well, which costs a pass over the edges: files from untrusted sources
+// must be opened that way, since the checks rely on them being well formed.
+inline Kripke load_kripke(const std::string& path, bool validate = false) {
+    auto file = std::make_shared<MappedFile>(path);
+    const char* base = file->data();
+    const std::uint64_t size = file->size();
+
+    KripkeFileHeader h;
+    if (size < sizeof(h)) {
+        throw std::runtime_error(path + " is not a Kripke file");
+    }
+    std::memcpy(&h, base, sizeof(h));
+    if (std::memcmp(h.magic, kripke_file_magic, sizeof(h.magic)) != 0) {
+        throw std::runtime_error(path + " is not a Kripke file");
+    }
+    if (h.byte_order != kripke_file_byte_order) {
+        throw std::runtime_error(path + " has a foreign byte order");
+    }
+    if (h.version != kripke_file_version) {
+        throw std::runtime_error(path + " has unsupported version " +
+                                 std::to_string(h.version));
+    }
+
+    const std::uint64_t n = h.num_states;
+    const std::uint64_t words = (n + 63) / 64;
+    auto check = [&](std::uint64_t at, std::uint64_t count,
+                     std::uint64_t width) {
+        if (at % 8 != 0 || at > size ||
+            (width != 0 && count > (size - at) / width)) {
+            throw std::runtime_error(path + " is truncated or corrupt");
+        }
+    };
+    if (n > std::uint64_t(INT32_MAX) || h.file_size != size) {
+        throw std::runtime_error(path + " is truncated or corrupt");
+    }
+    check(h.ids, n, 4);
+    check(h.offsets, n + 1, 8);
+    check(h.targets, h.num_edges, 4);
+    check(h.ap_names, h.num_aps + 1, 8);
+    check(h.labels, h.num_aps, 8 * words);
+    check(h.initial, h.num_initial, 4);
+
+    const int* ids = reinterpret_cast<const int*>(base + h.ids);
+    const std::size_t* offsets =
+        reinterpret_cast<const std::size_t*>(base + h.offsets);
+    const int* targets = reinterpret_cast<const int*>(base + h.targets);
+    if (offsets[0] != 0 || offsets[n] != h.num_edges) {
+        throw std::runtime_error(path + " is truncated or corrupt");
+    }
+    for (std::uint64_t v = 0; validate && v < n; v++) {
+        if (offsets[v] > offsets[v + 1] || (v > 0 && ids[v - 1] >= ids[v])) {
+            throw std::runtime_error(path + " is truncated or corrupt");
+        }
+    }
+    for (std::uint64_t e = 0; validate && e < h.num_edges; e++) {
+        if (targets[e] < 0 || std::uint64_t(targets[e]) >= n) {
+            throw std::runtime_error(path + " is truncated or corrupt");
+        }
+    }
+    CSRGraph G(file, n, ids, offsets, targets, true);
+
+    const std::uint64_t* name_offsets =
+        reinterpret_cast<const std::uint64_t*>(base + h.ap_names);
+    const char* chars = base + h.ap_names + 8 * (h.num_aps + 1);
+    const std::uint64_t* labels =
+        reinterpret_cast<const std::uint64_t*>(base + h.labels);
+    std::vector<std::string> names;
+    std::vector<StateSet> columns;
+    for (std::uint64_t a = 0; a < h.num_aps; a++) {
+        std::uint64_t first = name_offsets[a], last = name_offsets[a + 1];
+        if (first > last || last > size - (chars - base)) {
+            throw std::runtime_error(path + " is truncated or corrupt");
+        }
+        names.emplace_back(chars + first, chars + last);
+        columns.emplace_back(n, labels + a * words);
+    }
+
+    const int* initial = reinterpret_cast<const int*>(base + h.initial);
+    std::unordered_set<int> S0;
+    for (std::uint64_t i = 0; i < h.num_initial; i++) {
+        if (initial[i] < 0 || std::uint64_t(initial[i]) >= n) {
+            throw std::runtime_error(path + " is truncated or corrupt");
+        }
+        S0.insert(ids[initial[i]]);
+    }
+
+    return Kripke(std::move(G), S0, std::move(names), std::move(columns));
+}
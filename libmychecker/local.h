@@ -0,0 +1,342 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "checker.h"
+#include "formula.h"
+#include "formula_table.h"
+#include "graph.h"
+#include "kripke.h"
+#include "parallel_scc.h"
+#include "stateset.h"
+
+// The states of a Kripke structure as searched by a LocalChecker: its CSR
+// graph, with the label set of each AP looked up once.
+class _KripkeGraph {
+   public:
+    explicit _KripkeGraph(const Kripke& kripke)
+        : _kripke(kripke), _G(kripke.csr()) {}
+
+    int size() const { return _G.size(); }
+
+    IndexRange successors(int v) { return _G.successors(v); }
+
+    bool label(int ap, const std::string& name, int v) {
+        if (ap >= int(_aps.size())) {
+            _aps.resize(ap + 1, nullptr);
+            _resolved.resize(ap + 1, 0);
+        }
+        if (!_resolved[ap]) {
+            _aps[ap] = _kripke.ap_states(name);
+            _resolved[ap] = 1;
+        }
+        return _aps[ap] != nullptr && _aps[ap]->contains(v);
+    }
+
+    void initial_states(std::vector<int>& result) {
+        for (int s : _kripke.initial_states()) {
+            result.push_back(_G.index(s));
+        }
+    }
+
+   private:
+    const Kripke& _kripke;
+    const CSRGraph& _G;
+    std::vector<const StateSet*> _aps;
+    std::vector<char> _resolved;
+};
+
+// Decides formulas state by state instead of computing whole satisfaction
+// sets. EX, EU and EG are evaluated by depth-first searches from the queried
+// state that stop as soon as its value is known, and every state a search
+// settles is memoised per formula id, so later queries (also through other
+// formulas sharing the subformula) reuse it. Universal operators go through
+// the restricted basis, e.g. AG p = !E[true U !p], so a counterexample found
+// early ends their search as well.
+//
+// States are the dense indices of a Graph with size(), successors(v) (whose
+// range must stay valid while states are added), label(ap, name, v) and
+// initial_states(result). The graph may number further states as the
+// searches reach them, so it can be generated on the fly.
+template <typename Graph>
+class BasicLocalChecker {
+   public:
+    BasicLocalChecker(Graph graph, FormulaTable& formulas)
+        : _graph(std::move(graph)), _formulas(formulas) {}
+
+    // Value of formula `id` in the state of dense index v.
+    bool holds(int id, int v) {
+        const FormulaNode& node = _formulas.node(id);
+        if (node.opcode == OpCode::Atomic) {
+            return _graph.label(node.ap, _formulas.ap_name(node.ap), v);
+        }
+        _Memo& m = memo(id);
+        if (m.known.contains(v)) {
+            return m.value.contains(v);
+        }
+        bool result = _evaluate(id, v);
+        settle(memo(id), v, result);
+        return result;
+    }
+
+    // Whether `id` holds in every initial state; stops at the first one
+    // where it does not.
+    bool holds_initially(int id) {
+        std::vector<int> initial;
+        _graph.initial_states(initial);
+        for (int v : initial) {
+            if (!holds(id, v)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Number of (formula, state) values computed so far.
+    std::size_t num_settled() const { return _settled; }
+
+   protected:
+    Graph _graph;
+
+   private:
+    struct _Memo {
+        StateSet known;
+        StateSet value;
+        // Scratch marks of a running search.
+        StateSet visited;
+        StateSet on_stack;
+    };
+
+    typedef std::vector<std::pair<int, const int*>> _Stack;
+
+    FormulaTable& _formulas;
+    // A deque, so that memos stay in place while nested searches add more.
+    std::deque<_Memo> _memos;
+    std::size_t _settled = 0;
+
+    // The memo of id, sized to the states numbered so far. Indices of
+    // states reached earlier stay valid in a memo obtained before them.
+    _Memo& memo(int id) {
+        if (id >= int(_memos.size())) {
+            _memos.resize(id + 1);
+        }
+        _Memo& m = _memos[id];
+        int n = _graph.size();
+        if (m.known.size() != n) {
+            m.known.resize(n);
+            m.value.resize(n);
+            if (m.visited.size() != 0) {
+                m.visited.resize(n);
+                m.on_stack.resize(n);
+            }
+        }
+        return m;
+    }
+
+    // Sizes the search marks of a memo, on its first search.
+    static void _prepare(_Memo& m) {
+        if (m.visited.size() != m.known.size()) {
+            m.visited.resize(m.known.size());
+            m.on_stack.resize(m.known.size());
+        }
+    }
+
+    void settle(_Memo& m, int v, bool value) {
+        if (m.known.test_and_insert(v)) {
+            _settled++;
+            if (value) {
+                m.value.insert(v);
+            }
+        }
+    }
+
+    bool _evaluate(int id, int v) {
+        // Copied out, since restricted() may grow the table.
+        const FormulaNode& node = _formulas.node(id);
+        OpCode opcode = node.opcode;
+        int left = node.left;
+        int right = node.right;
+        int ap = node.ap;
+        switch (opcode) {
+            case (OpCode::Not): {
+                return !holds(left, v);
+            }
+            case (OpCode::Or): {
+                return holds(left, v) || holds(right, v);
+            }
+            case (OpCode::Bool): {
+                return ap;
+            }
+            case (OpCode::E): {
+                const FormulaNode& path = _formulas.node(left);
+                int phi = path.left;
+                int psi = path.right;
+                switch (path.opcode) {
+                    case (OpCode::X): {
+                        for (int w : _graph.successors(v)) {
+                            if (holds(phi, w)) {
+                                return true;
+                            }
+                        }
+                        return false;
+                    }
+                    case (OpCode::U): {
+                        return _checkEU(id, phi, psi, v);
+                    }
+                    case (OpCode::G): {
+                        return _checkEG(id, phi, v);
+                    }
+                }
+            }
+        }
+        return holds(_formulas.restricted(id), v);
+    }
+
+    // E[phi U psi] at v: searches the phi-paths from v for a psi-state. Once
+    // one is found, every state on the search stack reaches it; if the
+    // search ends without one, no visited state can reach one.
+    bool _checkEU(int id, int phi, int psi, int v) {
+        _prepare(memo(id));
+        std::vector<int> visited;
+        _Stack stack;
+        bool found = _enterEU(id, phi, psi, v, visited, stack);
+        while (!found && !stack.empty()) {
+            std::pair<int, const int*>& top = stack.back();
+            if (top.second == _graph.successors(top.first).end()) {
+                stack.pop_back();
+                continue;
+            }
+            int w = *top.second++;
+            found = _enterEU(id, phi, psi, w, visited, stack);
+        }
+
+        _Memo& m = memo(id);
+        for (const auto& entry : stack) {
+            settle(m, entry.first, true);
+        }
+        for (int s : visited) {
+            if (!found) {
+                settle(m, s, false);
+            }
+            m.visited.erase(s);
+        }
+        return found;
+    }
+
+    bool _enterEU(int id, int phi, int psi, int w, std::vector<int>& visited,
+                  _Stack& stack) {
+        _Memo& m = memo(id);
+        if (m.visited.contains(w)) {
+            return false;
+        }
+        if (m.known.contains(w)) {
+            return m.value.contains(w);
+        }
+        if (holds(psi, w)) {
+            settle(m, w, true);
+            return true;
+        }
+        if (!holds(phi, w)) {
+            settle(m, w, false);
+            return false;
+        }
+        m.visited.insert(w);
+        visited.push_back(w);
+        stack.emplace_back(w, _graph.successors(w).begin());
+        return false;
+    }
+
+    // EG phi at v: searches the phi-states reachable from v for a cycle.
+    // Once an edge closes one, every state on the search stack has an
+    // infinite phi-path; a state the search backtracks from cannot reach a
+    // cycle, since any edge back onto the stack would have closed one.
+    bool _checkEG(int id, int phi, int v) {
+        _prepare(memo(id));
+        std::vector<int> visited;
+        _Stack stack;
+        bool found = _enterEG(id, phi, v, visited, stack);
+        while (!found && !stack.empty()) {
+            std::pair<int, const int*>& top = stack.back();
+            if (top.second == _graph.successors(top.first).end()) {
+                _Memo& m = memo(id);
+                m.on_stack.erase(top.first);
+                settle(m, top.first, false);
+                stack.pop_back();
+                continue;
+            }
+            int w = *top.second++;
+            found = _enterEG(id, phi, w, visited, stack);
+        }
+
+        _Memo& m = memo(id);
+        for (const auto& entry : stack) {
+            m.on_stack.erase(entry.first);
+            settle(m, entry.first, true);
+        }
+        for (int s : visited) {
+            m.visited.erase(s);
+        }
+        return found;
+    }
+
+    bool _enterEG(int id, int phi, int w, std::vector<int>& visited,
+                  _Stack& stack) {
+        _Memo& m = memo(id);
+        if (m.on_stack.contains(w)) {
+            return true;
+        }
+        if (m.visited.contains(w)) {
+            return false;
+        }
+        if (m.known.contains(w)) {
+            return m.value.contains(w);
+        }
+        if (!holds(phi, w)) {
+            settle(m, w, false);
+            return false;
+        }
+        m.visited.insert(w);
+        m.on_stack.insert(w);
+        visited.push_back(w);
+        stack.emplace_back(w, _graph.successors(w).begin());
+        return false;
+    }
+};
+
+// A BasicLocalChecker on an explicit Kripke structure.
+class LocalChecker : public BasicLocalChecker<_KripkeGraph> {
+   public:
+    LocalChecker(const Kripke& kripke, FormulaTable& formulas)
+        : BasicLocalChecker(_KripkeGraph(kripke), formulas) {}
+};
+
+// Decides whether `formula` holds in every initial state of `kripke`,
+// exploring only the states needed for the verdict. Fair path quantifiers
+// have no local search here, so under fairness constraints the formula is
+// checked globally.
+inline bool modelcheck_initial(Kripke& kripke,
+                               std::shared_ptr<Formula> formula,
+                               std::vector<std::unordered_set<int>>& F,
+                               const SCCOptions& options = SCCOptions()) {
+    if (F.size() != 0) {
+        Labelling L;
+        L.options.scc = options;
+        const StateSet& S = L[modelcheck(kripke, formula, L, F)];
+        const CSRGraph& G = kripke.csr();
+        for (int s : kripke.initial_states()) {
+            if (!S.contains(G.index(s))) {
+                return false;
+            }
+        }
+        return true;
+    }
+    FormulaTable formulas;
+    int id = formulas.intern(formula);
+    LocalChecker checker(kripke, formulas);
+    return checker.holds_initially(id);
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "formula_table.h"
+#include "graph.h"
+#include "implicit.h"
+#include "kripke.h"
+#include "stateset.h"
+
+// Parameterised model families for benchmarks. Every model labels its
+// states with the APs "p" and "q", so one property set applies to all of
+// them, and has no deadlocks. State ids are 0..n-1, equal to their dense
+// indices, and structures are built directly in CSR form.
+
+// Builds a frozen Kripke structure over states 0..n-1 whose successors are
+// listed by `successors(v, out)` and whose p- and q-states are decided by
+// `p` and `q`. The initial state is 0.
+template <typename Successors, typename P, typename Q>
+Kripke _generatedModel(int n, Successors successors, P p, Q q) {
+    std::vector<int> ids(n);
+    std::vector<std::size_t> offsets{0};
+    std::vector<int> targets;
+    StateSet in_p(n);
+    StateSet in_q(n);
+    std::vector<int> row;
+    for (int v = 0; v < n; v++) {
+        ids[v] = v;
+        row.clear();
+        successors(v, row);
+        std::sort(row.begin(), row.end());
+        row.erase(std::unique(row.begin(), row.end()), row.end());
+        targets.insert(targets.end(), row.begin(), row.end());
+        offsets.push_back(targets.size());
+        if (p(v)) {
+            in_p.insert(v);
+        }
+        if (q(v)) {
+            in_q.insert(v);
+        }
+    }
+    std::vector<StateSet> columns;
+    columns.push_back(std::move(in_p));
+    columns.push_back(std::move(in_q));
+    return Kripke(
+        CSRGraph(std::move(ids), std::move(offsets), std::move(targets)),
+        {0}, {"p", "q"}, std::move(columns));
+}
+
+// A cycle of n states; p holds on even states, q on multiples of 16.
+inline Kripke ring_model(int n) {
+    return _generatedModel(
+        n, [&](int v, std::vector<int>& out) { out.push_back((v + 1) % n); },
+        [](int v) { return v % 2 == 0; }, [](int v) { return v % 16 == 0; });
+}
+
+// A w x h torus where every state steps right or down; p holds off the
+// diagonal, q in the last column.
+inline Kripke grid_model(int w, int h) {
+    return _generatedModel(
+        w * h,
+        [&](int v, std::vector<int>& out) {
+            int x = v % w;
+            int y = v / w;
+            out.push_back(y * w + (x + 1) % w);
+            out.push_back(((y + 1) % h) * w + x);
+        },
+        [&](int v) { return v % w != v / w; },
+        [&](int v) { return v % w == w - 1; });
+}
+
+// n states with `degree` successors each, drawn uniformly from `seed`;
+// p holds on a random half of the states, q on a random tenth.
+inline Kripke random_model(int n, int degree, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<char> p(n);
+    std::vector<char> q(n);
+    for (int v = 0; v < n; v++) {
+        p[v] = rng() % 2 == 0;
+        q[v] = rng() % 10 == 0;
+    }
+    return _generatedModel(
+        n,
+        [&](int, std::vector<int>& out) {
+            for (int k = 0; k < degree; k++) {
+                out.push_back(rng() % n);
+            }
+        },
+        [&](int v) { return p[v]; }, [&](int v) { return q[v]; });
+}
+
+// A complete binary tree of the given depth whose leaves loop back to the
+// root; p holds on left children, q on the leaves.
+inline Kripke tree_model(int depth) {
+    int n = (1 << (depth + 1)) - 1;
+    int leaves = 1 << depth;
+    return _generatedModel(
+        n,
+        [&](int v, std::vector<int>& out) {
+            if (v >= n - leaves) {
+                out.push_back(0);
+            } else {
+                out.push_back(2 * v + 1);
+                out.push_back(2 * v + 2);
+            }
+        },
+        [](int v) { return v % 2 == 1; },
+        [&](int v) { return v >= n - leaves; });
+}
+
+// Dining philosophers: the reachable product of n philosophers around a
+// table, each thinking, hungry or eating, and moving one at a time. A
+// hungry philosopher may eat while neither neighbour eats. p holds while
+// philosopher 0 eats, q while it is hungry. Built by exploring an
+// ImplicitModel whose states pack two bits per philosopher, so n <= 32.
+inline Kripke philosophers_model(int n) {
+    if (n < 2 || n > 32) {
+        throw std::runtime_error("Expected 2 to 32 philosophers");
+    }
+    typedef ImplicitModel::State State;
+    auto phase = [](State s, int i) { return int((s >> (2 * i)) & 3); };
+    CallbackModel model(
+        [](std::vector<State>& out) { out.push_back(0); },
+        [&](State s, std::vector<State>& out) {
+            for (int i = 0; i < n; i++) {
+                State bit = State(1) << (2 * i);
+                int left = phase(s, (i + n - 1) % n);
+                int right = phase(s, (i + 1) % n);
+                switch (phase(s, i)) {
+                    case 0: {
+                        out.push_back(s + bit);
+                        break;
+                    }
+                    case 1: {
+                        if (left != 2 && right != 2) {
+                            out.push_back(s + bit);
+                        }
+                        break;
+                    }
+                    default: {
+                        out.push_back(s - 2 * bit);
+                    }
+                }
+            }
+        },
+        [&](State s, const std::string& ap) {
+            return phase(s, 0) == (ap == "p" ? 2 : 1);
+        });
+    ExploredModel explored(model);
+    FormulaTable aps;
+    aps.atomic("p");
+    aps.atomic("q");
+    explored.label_aps(aps);
+    return explored.kripke();
+}
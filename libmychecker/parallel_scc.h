@@ -0,0 +1,273 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "graph.h"
+#include "stateset.h"
+#include "threadpool.h"
+
+typedef enum { Tarjan, ForwardBackward } SCCAlgorithm;
+
+// Selects the SCC engine for a single decomposition. ForwardBackward runs on
+// `pool` if one is given, and otherwise on a pool of `num_threads` threads
+// (0 meaning one per hardware thread) created for the call.
+struct SCCOptions {
+    SCCAlgorithm algorithm = SCCAlgorithm::Tarjan;
+    int num_threads = 0;
+    ThreadPool* pool = nullptr;
+};
+
+class _ForwardBackwardSCC {
+   public:
+    _ForwardBackwardSCC(const CSRGraph& G, const CSRGraph& pre,
+                        ThreadPool& pool, SCCDecomposition& result)
+        : G(G),
+          pre(pre),
+          pool(pool),
+          result(result),
+          color(G.size()),
+          next_color(1) {}
+
+    void run(const StateSet* mask) {
+        const int n = G.size();
+        result.clear();
+        result.nodes.reserve(n);
+        std::vector<int> active;
+        for (int v = 0; v < n; v++) {
+            bool in_graph = mask == nullptr || mask->contains(v);
+            color[v].store(in_graph ? 0 : done, std::memory_order_relaxed);
+            if (in_graph) {
+                active.push_back(v);
+            }
+        }
+
+        trim(active);
+
+        std::vector<int> members;
+        for (int v : active) {
+            if (color[v].load(std::memory_order_relaxed) == 0) {
+                members.push_back(v);
+            }
+        }
+
+        TaskGroup group(pool);
+        if (!members.empty()) {
+            group.run([this, &group, members] { solve(group, 0, members); });
+        }
+        group.wait();
+    }
+
+   private:
+    static constexpr int done = -1;
+    static constexpr std::size_t grain = 4096;
+
+    const CSRGraph& G;
+    const CSRGraph& pre;
+    ThreadPool& pool;
+    SCCDecomposition& result;
+    std::vector<std::atomic<int>> color;
+    std::atomic<int> next_color;
+    std::mutex result_mutex;
+
+    // Runs body(first, last) over [0, n) in chunks on the pool.
+    template <typename Body>
+    void parallel_for(std::size_t n, Body body) {
+        if (n <= grain || pool.size() == 1) {
+            body(std::size_t(0), n);
+            return;
+        }
+        TaskGroup group(pool);
+        for (std::size_t first = 0; first < n; first += grain) {
+            std::size_t last = std::min(n, first + grain);
+            group.run([&body, first, last] { body(first, last); });
+        }
+        group.wait();
+    }
+
+    void emit(const SCCDecomposition& sccs) {
+        std::lock_guard<std::mutex> lock(result_mutex);
+        for (int k = 0; k < sccs.size(); k++) {
+            result.push_back(sccs[k].begin(), sccs[k].end());
+        }
+    }
+
+    bool claim(int v, int from, int to) {
+        return color[v].compare_exchange_strong(from, to,
+                                                std::memory_order_relaxed);
+    }
+
+    // Repeatedly removes active nodes without active predecessors or
+    // successors; each of them is a singleton SCC.
+    void trim(const std::vector<int>& active) {
+        const int n = G.size();
+        std::vector<std::atomic<int>> in_degree(n), out_degree(n);
+        parallel_for(active.size(), [&](std::size_t first, std::size_t last) {
+            for (std::size_t i = first; i < last; i++) {
+                int v = active[i];
+                int in = 0, out = 0;
+                for (int u : pre.successors(v)) {
+                    in += u != v && color[u].load() == 0;
+                }
+                for (int w : G.successors(v)) {
+                    out += w != v && color[w].load() == 0;
+                }
+                in_degree[v].store(in, std::memory_order_relaxed);
+                out_degree[v].store(out, std::memory_order_relaxed);
+            }
+        });
+
+        std::vector<int> frontier;
+        for (int v : active) {
+            if (in_degree[v].load() == 0 || out_degree[v].load() == 0) {
+                frontier.push_back(v);
+            }
+        }
+
+        std::mutex frontier_mutex;
+        while (!frontier.empty()) {
+            std::vector<int> next;
+            parallel_for(frontier.size(), [&](std::size_t first,
+                                              std::size_t last) {
+                std::vector<int> local_next;
+                SCCDecomposition sccs;
+                auto peel = [&](int v) {
+                    if (!claim(v, 0, done)) {
+                        return;
+                    }
+                    sccs.push_back(&v, &v + 1);
+                    for (int w : G.successors(v)) {
+                        if (w != v && color[w].load() == 0 &&
+                            in_degree[w].fetch_sub(1) == 1) {
+                            local_next.push_back(w);
+                        }
+                    }
+                    for (int u : pre.successors(v)) {
+                        if (u != v && color[u].load() == 0 &&
+                            out_degree[u].fetch_sub(1) == 1) {
+                            local_next.push_back(u);
+                        }
+                    }
+                };
+                for (std::size_t i = first; i < last; i++) {
+                    peel(frontier[i]);
+                }
+                emit(sccs);
+                std::lock_guard<std::mutex> lock(frontier_mutex);
+                next.insert(next.end(), local_next.begin(), local_next.end());
+            });
+            frontier.swap(next);
+        }
+    }
+
+    // Level-synchronous search from `pivot` along `graph`. A node w is
+    // visited if its color is `from` (it is then recolored to `to`) or
+    // `from2` (recolored to `to2`); visited nodes are appended to `visited`.
+    void reach(const CSRGraph& graph, int pivot, int from, int to, int from2,
+               int to2, std::vector<int>& visited) {
+        std::vector<int> frontier{pivot};
+        visited.push_back(pivot);
+        std::mutex visited_mutex;
+        while (!frontier.empty()) {
+            std::vector<int> next;
+            parallel_for(frontier.size(), [&](std::size_t first,
+                                              std::size_t last) {
+                std::vector<int> local_next;
+                for (std::size_t i = first; i < last; i++) {
+                    for (int w : graph.successors(frontier[i])) {
+                        if (claim(w, from, to) ||
+                            (from2 != done && claim(w, from2, to2))) {
+                            local_next.push_back(w);
+                        }
+                    }
+                }
+                std::lock_guard<std::mutex> lock(visited_mutex);
+                next.insert(next.end(), local_next.begin(), local_next.end());
+            });
+            visited.insert(visited.end(), next.begin(), next.end());
+            frontier.swap(next);
+        }
+    }
+
+    void solve(TaskGroup& group, int c, std::vector<int> members) {
+        if (members.size() == 1) {
+            color[members[0]].store(done);
+            std::lock_guard<std::mutex> lock(result_mutex);
+            result.push_back(members.data(), members.data() + 1);
+            return;
+        }
+
+        int fw = next_color++;
+        int bw = next_color++;
+        int scc_color = next_color++;
+        int pivot = members[0];
+
+        std::vector<int> fw_visited, bw_visited;
+        color[pivot].store(fw);
+        reach(G, pivot, c, fw, done, done, fw_visited);
+        color[pivot].store(scc_color);
+        reach(pre, pivot, fw, scc_color, c, bw, bw_visited);
+
+        std::vector<int> scc, fw_only, bw_only, rest;
+        for (int v : bw_visited) {
+            int cv = color[v].load();
+            if (cv == scc_color) {
+                color[v].store(done);
+                scc.push_back(v);
+            } else if (cv == bw) {
+                bw_only.push_back(v);
+            }
+        }
+        for (int v : fw_visited) {
+            if (color[v].load() == fw) {
+                fw_only.push_back(v);
+            }
+        }
+        for (int v : members) {
+            if (color[v].load() == c) {
+                rest.push_back(v);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(result_mutex);
+            result.push_back(scc.data(), scc.data() + scc.size());
+        }
+
+        spawn(group, fw, std::move(fw_only));
+        spawn(group, bw, std::move(bw_only));
+        spawn(group, c, std::move(rest));
+    }
+
+    void spawn(TaskGroup& group, int c, std::vector<int> members) {
+        if (members.empty()) {
+            return;
+        }
+        group.run([this, &group, c, members]() mutable {
+            solve(group, c, std::move(members));
+        });
+    }
+};
+
+// Multi-threaded forward-backward SCC decomposition with trimming. Produces
+// the same SCCs as compute_SCCs (in no particular order); `pre` must be the
+// reverse graph of `G`.
+inline void compute_SCCs_parallel(const CSRGraph& G, const CSRGraph& pre,
+                                  SCCDecomposition& result, ThreadPool& pool,
+                                  const StateSet* mask = nullptr) {
+    _ForwardBackwardSCC(G, pre, pool, result).run(mask);
+}
+
+inline void compute_SCCs(const CSRGraph& G, const CSRGraph& pre,
+                         SCCDecomposition& result,
+                         const SCCOptions& options,
+                         const StateSet* mask = nullptr) {
+    if (options.algorithm == SCCAlgorithm::Tarjan) {
+        return compute_SCCs(G, result, mask);
+    }
+    if (options.pool != nullptr) {
+        return compute_SCCs_parallel(G, pre, result, *options.pool, mask);
+    }
+    ThreadPool pool(options.num_threads);
+    compute_SCCs_parallel(G, pre, result, pool, mask);
+}
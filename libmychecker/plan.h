@@ -0,0 +1,116 @@
+#pragma once
+#include <vector>
+
+#include "formula.h"
+#include "formula_table.h"
+
+// Instructions of an EvaluationPlan, one per operator of the restricted
+// basis. Alias makes a formula share the result of its restricted rewrite.
+enum class PlanOp { Bool, Atomic, Not, Or, EX, EU, EG, Alias };
+
+inline const char* plan_op_name(PlanOp op) {
+    static const char* names[] = {"Bool", "Atomic", "Not", "Or",
+                                  "EX",   "EU",     "EG",  "Alias"};
+    return names[int(op)];
+}
+
+// Computes the result of formula `slot` from the results of the operand
+// slots `left` and `right` (-1 if unused). Slots are formula ids, i.e.
+// entries of a Labelling. For Bool, `left` is the value; for Atomic, the
+// interned AP.
+struct PlanStep {
+    PlanOp op;
+    int slot;
+    int left;
+    int right;
+
+    // Number of operand slots, taken from left then right.
+    int arity() const {
+        switch (op) {
+            case (PlanOp::Bool):
+            case (PlanOp::Atomic):
+                return 0;
+            case (PlanOp::Or):
+            case (PlanOp::EU):
+                return 2;
+            default:
+                return 1;
+        }
+    }
+};
+
+// Formulas compiled into the restricted basis: every subformula they need,
+// once, with operands before the steps that read them. All rewrites happen
+// while compiling, so running a plan only dispatches on PlanOp.
+struct EvaluationPlan {
+    std::vector<PlanStep> steps;
+    std::vector<int> roots;
+};
+
+inline PlanStep _planStep(FormulaTable& formulas, int id) {
+    if (!formulas.is_restricted(id)) {
+        return PlanStep{PlanOp::Alias, id, formulas.restricted(id), -1};
+    }
+    const FormulaNode& node = formulas.node(id);
+    switch (node.opcode) {
+        case (OpCode::Bool): {
+            return PlanStep{PlanOp::Bool, id, node.ap, -1};
+        }
+        case (OpCode::Atomic): {
+            return PlanStep{PlanOp::Atomic, id, node.ap, -1};
+        }
+        case (OpCode::Not): {
+            return PlanStep{PlanOp::Not, id, node.left, -1};
+        }
+        case (OpCode::Or): {
+            return PlanStep{PlanOp::Or, id, node.left, node.right};
+        }
+    }
+    const FormulaNode& path = formulas.node(node.left);
+    switch (path.opcode) {
+        case (OpCode::X): {
+            return PlanStep{PlanOp::EX, id, path.left, -1};
+        }
+        case (OpCode::U): {
+            return PlanStep{PlanOp::EU, id, path.left, path.right};
+        }
+        default: {
+            return PlanStep{PlanOp::EG, id, path.left, -1};
+        }
+    }
+}
+
+// Compiles the interned formulas `roots` of `formulas`, rewriting them into
+// the restricted basis where needed.
+inline EvaluationPlan compile_plan(FormulaTable& formulas,
+                                   const std::vector<int>& roots) {
+    EvaluationPlan plan;
+    plan.roots = roots;
+    // 1 once a formula's operands are pushed, 2 once its step is emitted.
+    std::vector<char> state;
+    std::vector<int> stack(roots.rbegin(), roots.rend());
+    while (!stack.empty()) {
+        int id = stack.back();
+        state.resize(formulas.size(), 0);
+        if (state[id] == 2) {
+            stack.pop_back();
+            continue;
+        }
+        PlanStep step = _planStep(formulas, id);
+        state.resize(formulas.size(), 0);
+        if (state[id] == 0) {
+            state[id] = 1;
+            int operands[] = {step.left, step.right};
+            for (int k = step.arity() - 1; k >= 0; k--) {
+                if (state[operands[k]] != 2) {
+                    stack.push_back(operands[k]);
+                }
+            }
+            continue;
+        }
+        stack.pop_back();
+        state[id] = 2;
+        plan.steps.push_back(step);
+    }
+    return plan;
+}
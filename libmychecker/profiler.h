@@ -0,0 +1,186 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Work done by one step of a check: rounds of its fixpoint (breadth-first
+// layers), and the states and edges it visited.
+struct StepStats {
+    long iterations = 0;
+    long states = 0;
+    long edges = 0;
+};
+
+// Collects timed events of checks run with CheckOptions::profiler set: one
+// per evaluated subformula, with its work and result size, and one per
+// phase (SCC decomposition, fair states, symbolic check). Checks without a
+// profiler only pay a null test per subformula. Events may be recorded
+// concurrently.
+class Profiler {
+   public:
+    struct Event {
+        // The formula, or the name of a phase.
+        std::string name;
+        // The operator of the formula, or "phase".
+        std::string category;
+        // Formula id, or -1 for a phase.
+        int formula;
+        // Microseconds since the profiler was created.
+        double start;
+        double duration;
+        int thread;
+        StepStats stats;
+        // States of the result, or -1 for a phase.
+        long result_size;
+    };
+
+    // Records the lifetime of the object as a phase.
+    class Phase {
+       public:
+        Phase(Profiler& profiler, const char* name)
+            : _profiler(profiler), _name(name), _start(profiler.now()) {}
+        Phase(const Phase&) = delete;
+
+        ~Phase() {
+            _profiler.record(Event{_name, "phase", -1, _start,
+                                   _profiler.now() - _start, 0, StepStats(),
+                                   -1});
+        }
+
+       private:
+        Profiler& _profiler;
+        const char* _name;
+        double _start;
+    };
+
+    Profiler() : _origin(std::chrono::steady_clock::now()) {}
+
+    double now() const {
+        std::chrono::duration<double, std::micro> d =
+            std::chrono::steady_clock::now() - _origin;
+        return d.count();
+    }
+
+    Phase phase(const char* name) { return Phase(*this, name); }
+
+    // Fills in the thread of `e`.
+    void record(Event e) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = _threads.emplace(std::this_thread::get_id(),
+                                      int(_threads.size()));
+        e.thread = found.first->second;
+        _events.push_back(std::move(e));
+    }
+
+    // Not safe while a check is still recording.
+    const std::vector<Event>& events() const { return _events; }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _events.clear();
+    }
+
+    // The events in Chrome's trace event format, for chrome://tracing,
+    // Perfetto or speedscope (which also shows them as a flame graph).
+    std::string chrome_trace() const {
+        std::string out = "{\"traceEvents\": [";
+        for (std::size_t i = 0; i < _events.size(); i++) {
+            const Event& e = _events[i];
+            out += i == 0 ? "\n" : ",\n";
+            out += "{\"name\": " + _json(e.name) +
+                   ", \"cat\": " + _json(e.category) +
+                   ", \"ph\": \"X\", \"pid\": 0, \"tid\": " +
+                   std::to_string(e.thread) + ", \"ts\": " + _num(e.start) +
+                   ", \"dur\": " + _num(e.duration) + ", \"args\": {";
+            if (e.formula != -1) {
+                out += "\"formula\": " + std::to_string(e.formula) +
+                       ", \"iterations\": " +
+                       std::to_string(e.stats.iterations) +
+                       ", \"states\": " + std::to_string(e.stats.states) +
+                       ", \"edges\": " + std::to_string(e.stats.edges) +
+                       ", \"result_size\": " + std::to_string(e.result_size);
+            }
+            out += "}}";
+        }
+        return out + "\n]}\n";
+    }
+
+    // Totals per phase and per formula id, as JSON.
+    std::string summary() const {
+        struct Total {
+            const Event* first;
+            int count;
+            double duration;
+            StepStats stats;
+        };
+        std::map<std::string, Total> phases;
+        std::map<int, Total> formulas;
+        for (const Event& e : _events) {
+            Total& t = e.formula == -1 ? phases[e.name] : formulas[e.formula];
+            if (t.count++ == 0) {
+                t.first = &e;
+            }
+            t.duration += e.duration;
+            t.stats.iterations += e.stats.iterations;
+            t.stats.states += e.stats.states;
+            t.stats.edges += e.stats.edges;
+        }
+
+        std::string out = "{\"phases\": [";
+        const char* separator = "\n";
+        for (const auto& entry : phases) {
+            out += separator;
+            out += "{\"name\": " + _json(entry.first) +
+                   ", \"count\": " + std::to_string(entry.second.count) +
+                   ", \"seconds\": " + _num(entry.second.duration / 1e6) +
+                   "}";
+            separator = ",\n";
+        }
+        out += "\n], \"formulas\": [";
+        separator = "\n";
+        for (const auto& entry : formulas) {
+            const Total& t = entry.second;
+            out += separator;
+            out += "{\"formula\": " + std::to_string(entry.first) +
+                   ", \"name\": " + _json(t.first->name) +
+                   ", \"operator\": " + _json(t.first->category) +
+                   ", \"count\": " + std::to_string(t.count) +
+                   ", \"seconds\": " + _num(t.duration / 1e6) +
+                   ", \"iterations\": " + std::to_string(t.stats.iterations) +
+                   ", \"states\": " + std::to_string(t.stats.states) +
+                   ", \"edges\": " + std::to_string(t.stats.edges) +
+                   ", \"result_size\": " +
+                   std::to_string(t.first->result_size) + "}";
+            separator = ",\n";
+        }
+        return out + "\n]}\n";
+    }
+
+   private:
+    std::chrono::steady_clock::time_point _origin;
+    std::mutex _mutex;
+    std::vector<Event> _events;
+    std::map<std::thread::id, int> _threads;
+
+    static std::string _json(const std::string& s) {
+        std::string out = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+            }
+            out += c;
+        }
+        return out + "\"";
+    }
+
+    static std::string _num(double x) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", x);
+        return buffer;
+    }
+};
@@ -0,0 +1,110 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "checker.h"
+#include "formula.h"
+#include "incremental.h"
+#include "kripke.h"
+#include "stateset.h"
+#include "symbolic.h"
+
+// Checks many properties against one Kripke structure. All formulas of a
+// session share one Labelling, so a subformula common to several properties
+// (or checked again later) is evaluated once, and the fair states are
+// computed once when the session is created. With the Symbolic engine the
+// BDD encoding of the structure is likewise built once per session. After
+// the structure is edited, recheck() brings all results up to date.
+class CheckSession {
+   public:
+    CheckSession(Kripke& kripke,
+                 const std::vector<std::unordered_set<int>>& F = {},
+                 const CheckOptions& options = CheckOptions())
+        : _kripke(kripke), _F(F) {
+        _L.options = options;
+        if (options.engine == CheckEngine::Symbolic) {
+            _symbolic.reset(new SymbolicChecker(kripke, _L.formulas, F));
+        } else if (F.size() != 0) {
+            _setFairness(kripke, F, _L);
+        }
+        kripke.clear_changes();
+    }
+
+    // Checks a batch of formulas and returns the id of each result.
+    std::vector<int> check(
+        const std::vector<std::shared_ptr<Formula>>& formulas) {
+        std::vector<int> ids;
+        ids.reserve(formulas.size());
+        for (const std::shared_ptr<Formula>& formula : formulas) {
+            ids.push_back(_L.formulas.intern(formula));
+        }
+        if (_symbolic) {
+            for (int id : ids) {
+                if (!_L.contains(id)) {
+                    BDD S = _symbolic->check(id);
+                    _L.set(id, _symbolic->model().decode(S));
+                }
+            }
+        } else {
+            _checkStateFormulas(_kripke, ids, _L);
+        }
+        return ids;
+    }
+
+    int check(std::shared_ptr<Formula> formula) {
+        return check(std::vector<std::shared_ptr<Formula>>{formula})[0];
+    }
+
+    // Updates every result of the session after the Kripke structure was
+    // edited. Under fairness the fair states and every temporal operator
+    // are recomputed; the Symbolic engine re-encodes the structure and
+    // re-checks every formula.
+    void recheck() {
+        if (_symbolic) {
+            _symbolic.reset(new SymbolicChecker(_kripke, _L.formulas, _F));
+            for (int id = 0; id < _L.formulas.size(); id++) {
+                if (_L.contains(id)) {
+                    BDD S = _symbolic->check(id);
+                    _L.set(id, _symbolic->model().decode(S));
+                }
+            }
+            _kripke.clear_changes();
+            return;
+        }
+        ::recheck(_kripke, _L);
+    }
+
+    // Checks a batch of formulas and reports, for each, whether it holds in
+    // every initial state.
+    std::vector<bool> verdicts(
+        const std::vector<std::shared_ptr<Formula>>& formulas) {
+        std::vector<bool> result;
+        for (int id : check(formulas)) {
+            result.push_back(holds(id));
+        }
+        return result;
+    }
+
+    const StateSet& states(int id) const { return _L.at(id); }
+
+    bool holds(int id) const {
+        const StateSet& S = _L.at(id);
+        const CSRGraph& G = _kripke.csr();
+        for (int s : _kripke.initial_states()) {
+            if (!S.contains(G.index(s))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Labelling& labelling() { return _L; }
+
+   private:
+    Kripke& _kripke;
+    std::vector<std::unordered_set<int>> _F;
+    Labelling _L;
+    std::unique_ptr<SymbolicChecker> _symbolic;
+};
@@ -0,0 +1,223 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// A set of dense state indices 0..size()-1 stored as a bitvector. Boolean
+// operations run a word at a time (four words at a time with AVX2), so they
+// are bound by memory bandwidth rather than by per-state probes. Bits past
+// size() are always zero.
+class StateSet {
+   public:
+    StateSet() : _size(0) {}
+
+    explicit StateSet(int size, bool full = false)
+        : _size(size), _words(num_words_for(size), full ? ~word_t(0) : 0) {
+        clear_tail();
+    }
+
+    // Copies the bits of `words`, which must hold (size + 63) / 64 words.
+    StateSet(int size, const std::uint64_t* words)
+        : _size(size), _words(words, words + num_words_for(size)) {
+        clear_tail();
+    }
+
+    int size() const { return _size; }
+
+    const std::uint64_t* data() const { return _words.data(); }
+    std::size_t num_words() const { return _words.size(); }
+
+    // Heap bytes held by the set.
+    std::size_t bytes() const { return _words.capacity() * sizeof(word_t); }
+
+    // Changes the range to 0..size-1; added states are not members.
+    void resize(int size) {
+        _size = size;
+        _words.resize(num_words_for(size), 0);
+        clear_tail();
+    }
+
+    bool contains(int v) const {
+        return (_words[v >> 6] >> (v & 63)) & 1;
+    }
+
+    void insert(int v) { _words[v >> 6] |= word_t(1) << (v & 63); }
+
+    void erase(int v) { _words[v >> 6] &= ~(word_t(1) << (v & 63)); }
+
+    // Inserts v and reports whether it was absent before.
+    bool test_and_insert(int v) {
+        word_t bit = word_t(1) << (v & 63);
+        word_t& w = _words[v >> 6];
+        if (w & bit) {
+            return false;
+        }
+        w |= bit;
+        return true;
+    }
+
+    std::size_t count() const {
+        std::size_t c = 0;
+        for (word_t w : _words) {
+            c += __builtin_popcountll(w);
+        }
+        return c;
+    }
+
+    bool empty() const {
+        for (word_t w : _words) {
+            if (w != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void clear() { std::fill(_words.begin(), _words.end(), 0); }
+
+    void fill() {
+        std::fill(_words.begin(), _words.end(), ~word_t(0));
+        clear_tail();
+    }
+
+    StateSet& operator|=(const StateSet& other) {
+        check_same_size(other);
+        word_t* a = _words.data();
+        const word_t* b = other._words.data();
+        std::size_t n = _words.size(), i = 0;
+#if defined(__AVX2__)
+        for (; i + 4 <= n; i += 4) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+            __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+            _mm256_storeu_si256((__m256i*)(a + i), _mm256_or_si256(x, y));
+        }
+#endif
+        for (; i < n; i++) {
+            a[i] |= b[i];
+        }
+        return *this;
+    }
+
+    StateSet& operator&=(const StateSet& other) {
+        check_same_size(other);
+        word_t* a = _words.data();
+        const word_t* b = other._words.data();
+        std::size_t n = _words.size(), i = 0;
+#if defined(__AVX2__)
+        for (; i + 4 <= n; i += 4) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+            __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+            _mm256_storeu_si256((__m256i*)(a + i), _mm256_and_si256(x, y));
+        }
+#endif
+        for (; i < n; i++) {
+            a[i] &= b[i];
+        }
+        return *this;
+    }
+
+    // Set difference: removes every member of `other`.
+    StateSet& operator-=(const StateSet& other) {
+        check_same_size(other);
+        word_t* a = _words.data();
+        const word_t* b = other._words.data();
+        std::size_t n = _words.size(), i = 0;
+#if defined(__AVX2__)
+        for (; i + 4 <= n; i += 4) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+            __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+            _mm256_storeu_si256((__m256i*)(a + i), _mm256_andnot_si256(y, x));
+        }
+#endif
+        for (; i < n; i++) {
+            a[i] &= ~b[i];
+        }
+        return *this;
+    }
+
+    void complement() {
+        word_t* a = _words.data();
+        std::size_t n = _words.size(), i = 0;
+#if defined(__AVX2__)
+        const __m256i ones = _mm256_set1_epi64x(-1);
+        for (; i + 4 <= n; i += 4) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+            _mm256_storeu_si256((__m256i*)(a + i), _mm256_xor_si256(x, ones));
+        }
+#endif
+        for (; i < n; i++) {
+            a[i] = ~a[i];
+        }
+        clear_tail();
+    }
+
+    StateSet operator|(const StateSet& other) const {
+        StateSet r(*this);
+        return r |= other;
+    }
+
+    StateSet operator&(const StateSet& other) const {
+        StateSet r(*this);
+        return r &= other;
+    }
+
+    StateSet operator-(const StateSet& other) const {
+        StateSet r(*this);
+        return r -= other;
+    }
+
+    StateSet operator~() const {
+        StateSet r(*this);
+        r.complement();
+        return r;
+    }
+
+    bool operator==(const StateSet& other) const {
+        return _size == other._size && _words == other._words;
+    }
+
+    bool operator!=(const StateSet& other) const { return !(*this == other); }
+
+    // Calls f(v) for every member v in increasing order.
+    template <typename Fn>
+    void for_each(Fn f) const {
+        std::size_t n = _words.size();
+        for (std::size_t i = 0; i < n; i++) {
+            word_t w = _words[i];
+            while (w != 0) {
+                f(int(i * 64 + __builtin_ctzll(w)));
+                w &= w - 1;
+            }
+        }
+    }
+
+    void to_vector(std::vector<int>& result) const {
+        for_each([&](int v) { result.push_back(v); });
+    }
+
+   private:
+    typedef std::uint64_t word_t;
+
+    int _size;
+    std::vector<word_t> _words;
+
+    static std::size_t num_words_for(int size) { return (size + 63) / 64; }
+
+    void clear_tail() {
+        if (_size % 64 != 0) {
+            _words.back() &= (word_t(1) << (_size % 64)) - 1;
+        }
+    }
+
+    void check_same_size(const StateSet& other) const {
+        if (_size != other._size) {
+            throw std::runtime_error("StateSets range over different states");
+        }
+    }
+};
@@ -0,0 +1,360 @@
+#pragma once
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "checker.h"
+#include "formula.h"
+#include "kripke.h"
+#include "stateset.h"
+
+// CTL formulas as types, for properties that are fixed at compile time:
+//
+//     struct req { static constexpr const char* name = "req"; };
+//     struct ack { static constexpr const char* name = "ack"; };
+//     namespace S = StaticCTL;
+//     using P = S::AG<S::Imply<S::Ap<req>, S::AF<S::Ap<ack>>>>;
+//     StateSet result = S::check<P>(kripke, L);
+//
+// Restricted<P> is the rewrite of P into {Not, Or, EX, EU, EG}, computed by
+// the compiler with the rules of FormulaTable::restricted. check<P> is
+// instantiated per subformula of that rewrite and calls the set kernels of
+// the Explicit engine directly, with no formula table or opcode dispatch.
+// to_formula<P>() builds the equivalent runtime Formula, so results of the
+// two can be compared.
+namespace StaticCTL {
+
+template <bool Value>
+struct Bool {};
+using True = Bool<true>;
+using False = Bool<false>;
+
+// Name must have a `static constexpr const char* name`.
+template <class Name>
+struct Ap {};
+
+template <class P>
+struct Not {};
+template <class P, class Q>
+struct Or {};
+template <class P, class Q>
+struct And {};
+template <class P, class Q>
+struct Imply {};
+
+template <class P>
+struct EX {};
+template <class P>
+struct AX {};
+template <class P>
+struct EF {};
+template <class P>
+struct AF {};
+template <class P>
+struct EG {};
+template <class P>
+struct AG {};
+template <class P, class Q>
+struct EU {};
+template <class P, class Q>
+struct AU {};
+template <class P, class Q>
+struct ER {};
+template <class P, class Q>
+struct AR {};
+
+// Negation, dropping a double negation.
+template <class P>
+struct _Neg {
+    using type = Not<P>;
+};
+template <class P>
+struct _Neg<Not<P>> {
+    using type = P;
+};
+template <class P>
+using Neg = typename _Neg<P>::type;
+
+template <class P>
+struct _Restrict;
+template <class P>
+using Restricted = typename _Restrict<P>::type;
+
+template <bool V>
+struct _Restrict<Bool<V>> {
+    using type = Bool<V>;
+};
+template <class N>
+struct _Restrict<Ap<N>> {
+    using type = Ap<N>;
+};
+template <class P>
+struct _Restrict<Not<P>> {
+    using type = Neg<Restricted<P>>;
+};
+template <class P, class Q>
+struct _Restrict<Or<P, Q>> {
+    using type = Or<Restricted<P>, Restricted<Q>>;
+};
+template <class P, class Q>
+struct _Restrict<And<P, Q>> {
+    using type = Neg<Or<Neg<Restricted<P>>, Neg<Restricted<Q>>>>;
+};
+template <class P, class Q>
+struct _Restrict<Imply<P, Q>> {
+    using type = Or<Neg<Restricted<P>>, Restricted<Q>>;
+};
+template <class P>
+struct _Restrict<EX<P>> {
+    using type = EX<Restricted<P>>;
+};
+template <class P>
+struct _Restrict<EF<P>> {
+    using type = EU<True, Restricted<P>>;
+};
+template <class P>
+struct _Restrict<EG<P>> {
+    using type = EG<Restricted<P>>;
+};
+template <class P, class Q>
+struct _Restrict<EU<P, Q>> {
+    using type = EU<Restricted<P>, Restricted<Q>>;
+};
+template <class P, class Q>
+struct _Restrict<ER<P, Q>> {
+    using P1 = Restricted<P>;
+    using Q1 = Restricted<Q>;
+    using type = Or<EU<Q1, Neg<Or<Neg<P1>, Neg<Q1>>>>, EG<Q1>>;
+};
+template <class P>
+struct _Restrict<AX<P>> {
+    using type = Neg<EX<Neg<Restricted<P>>>>;
+};
+template <class P>
+struct _Restrict<AF<P>> {
+    using type = Neg<EG<Neg<Restricted<P>>>>;
+};
+template <class P>
+struct _Restrict<AG<P>> {
+    using type = Neg<EU<True, Neg<Restricted<P>>>>;
+};
+template <class P, class Q>
+struct _Restrict<AU<P, Q>> {
+    using P1 = Restricted<P>;
+    using Q1 = Restricted<Q>;
+    using type = Neg<Or<EU<Neg<Q1>, Neg<Or<P1, Q1>>>, EG<Neg<Q1>>>>;
+};
+template <class P, class Q>
+struct _Restrict<AR<P, Q>> {
+    using type = Neg<EU<Neg<Restricted<P>>, Neg<Restricted<Q>>>>;
+};
+
+// The runtime Formula of a formula type.
+template <class P>
+struct _ToFormula;
+template <class P>
+std::shared_ptr<Formula> to_formula() {
+    return _ToFormula<P>::make();
+}
+
+template <bool V>
+struct _ToFormula<Bool<V>> {
+    static std::shared_ptr<Formula> make() {
+        return std::make_shared<CTL::Bool>(V);
+    }
+};
+template <class N>
+struct _ToFormula<Ap<N>> {
+    static std::shared_ptr<Formula> make() {
+        return std::make_shared<CTL::AtomicProposition>(N::name);
+    }
+};
+template <class P>
+struct _ToFormula<Not<P>> {
+    static std::shared_ptr<Formula> make() {
+        return std::make_shared<CTL::Not>(to_formula<P>());
+    }
+};
+template <class P, class Q>
+struct _ToFormula<Or<P, Q>> {
+    static std::shared_ptr<Formula> make() {
+        return std::make_shared<CTL::Or>(to_formula<P>(), to_formula<Q>());
+    }
+};
+template <class P, class Q>
+struct _ToFormula<And<P, Q>> {
+    static std::shared_ptr<Formula> make() {
+        return std::make_shared<CTL::And>(to_formula<P>(), to_formula<Q>());
+    }
+};
+template <class P, class Q>
+struct _ToFormula<Imply<P, Q>> {
+    static std::shared_ptr<Formula> make() {
+        return std::make_shared<CTL::Imply>(to_formula<P>(),
+                                            to_formula<Q>());
+    }
+};
+template <class P>
+struct _ToFormula<EX<P>> {
+    static std::shared_ptr<Formula> make() { return CTL::EX(to_formula<P>()); }
+};
+template <class P>
+struct _ToFormula<AX<P>> {
+    static std::shared_ptr<Formula> make() { return CTL::AX(to_formula<P>()); }
+};
+template <class P>
+struct _ToFormula<EF<P>> {
+    static std::shared_ptr<Formula> make() { return CTL::EF(to_formula<P>()); }
+};
+template <class P>
+struct _ToFormula<AF<P>> {
+    static std::shared_ptr<Formula> make() { return CTL::AF(to_formula<P>()); }
+};
+template <class P>
+struct _ToFormula<EG<P>> {
+    static std::shared_ptr<Formula> make() { return CTL::EG(to_formula<P>()); }
+};
+template <class P>
+struct _ToFormula<AG<P>> {
+    static std::shared_ptr<Formula> make() {
+        return std::make_shared<CTL::A>(
+            std::make_shared<CTL::G>(to_formula<P>()));
+    }
+};
+template <class P, class Q>
+struct _ToFormula<EU<P, Q>> {
+    static std::shared_ptr<Formula> make() {
+        return CTL::EU(to_formula<P>(), to_formula<Q>());
+    }
+};
+template <class P, class Q>
+struct _ToFormula<AU<P, Q>> {
+    static std::shared_ptr<Formula> make() {
+        return CTL::AU(to_formula<P>(), to_formula<Q>());
+    }
+};
+template <class P, class Q>
+struct _ToFormula<ER<P, Q>> {
+    static std::shared_ptr<Formula> make() {
+        return CTL::ER(to_formula<P>(), to_formula<Q>());
+    }
+};
+template <class P, class Q>
+struct _ToFormula<AR<P, Q>> {
+    static std::shared_ptr<Formula> make() {
+        return CTL::AR(to_formula<P>(), to_formula<Q>());
+    }
+};
+
+// Satisfaction sets of the subformulas evaluated by one check, keyed by
+// type, so that a subformula occurring several times in a rewrite is
+// evaluated once. AP columns are referred to, not copied.
+class _Results {
+   public:
+    template <class P>
+    static const void* key() {
+        static const char k = 0;
+        return &k;
+    }
+
+    const StateSet* find(const void* key) const {
+        for (const auto& entry : _views) {
+            if (entry.first == key) {
+                return entry.second;
+            }
+        }
+        return nullptr;
+    }
+
+    const StateSet& add(const void* key, const StateSet& S) {
+        _views.emplace_back(key, &S);
+        return S;
+    }
+
+    const StateSet& own(StateSet S) {
+        _owned.push_back(std::move(S));
+        return _owned.back();
+    }
+
+   private:
+    // A deque, so that views of owned sets stay valid.
+    std::deque<StateSet> _owned;
+    std::vector<std::pair<const void*, const StateSet*>> _views;
+};
+
+template <class P>
+struct _Eval;
+
+template <class P>
+const StateSet& _eval(Kripke& kripke, Labelling& L, _Results& results) {
+    const void* key = _Results::key<P>();
+    if (const StateSet* S = results.find(key)) {
+        return *S;
+    }
+    return results.add(key, _Eval<P>::run(kripke, L, results));
+}
+
+template <bool V>
+struct _Eval<Bool<V>> {
+    static const StateSet& run(Kripke& kripke, Labelling&, _Results& r) {
+        return r.own(StateSet(kripke.csr().size(), V));
+    }
+};
+template <class N>
+struct _Eval<Ap<N>> {
+    static const StateSet& run(Kripke& kripke, Labelling& L, _Results& r) {
+        const StateSet* S = kripke.ap_states(N::name);
+        if (S == nullptr) {
+            return r.own(StateSet(kripke.csr().size()));
+        }
+        if (!L.fairness.empty()) {
+            return r.own(*S & L.fair);
+        }
+        return *S;
+    }
+};
+template <class P>
+struct _Eval<Not<P>> {
+    static const StateSet& run(Kripke& kripke, Labelling& L, _Results& r) {
+        return r.own(~_eval<P>(kripke, L, r));
+    }
+};
+template <class P, class Q>
+struct _Eval<Or<P, Q>> {
+    static const StateSet& run(Kripke& kripke, Labelling& L, _Results& r) {
+        const StateSet& left = _eval<P>(kripke, L, r);
+        return r.own(left | _eval<Q>(kripke, L, r));
+    }
+};
+template <class P>
+struct _Eval<EX<P>> {
+    static const StateSet& run(Kripke& kripke, Labelling& L, _Results& r) {
+        return r.own(_EX(kripke, _eval<P>(kripke, L, r), L));
+    }
+};
+template <class P, class Q>
+struct _Eval<EU<P, Q>> {
+    static const StateSet& run(Kripke& kripke, Labelling& L, _Results& r) {
+        const StateSet& left = _eval<P>(kripke, L, r);
+        const StateSet& right = _eval<Q>(kripke, L, r);
+        return r.own(_EU(kripke, left, right, L, nullptr));
+    }
+};
+template <class P>
+struct _Eval<EG<P>> {
+    static const StateSet& run(Kripke& kripke, Labelling& L, _Results& r) {
+        return r.own(_EG(kripke, _eval<P>(kripke, L, r), L, nullptr));
+    }
+};
+
+// Satisfaction set of P, over the dense indices of kripke.csr(). L supplies
+// the fairness constraints and SCC options; its formula table is not used
+// and no witnesses are recorded.
+template <class P>
+StateSet check(Kripke& kripke, Labelling& L) {
+    _Results results;
+    return _eval<Restricted<P>>(kripke, L, results);
+}
+
+}  // namespace StaticCTL
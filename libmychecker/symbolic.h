@@ -0,0 +1,240 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "bdd.h"
+#include "formula_table.h"
+#include "graph.h"
+#include "kripke.h"
+#include "stateset.h"
+
+// A Kripke structure encoded in BDDs. The dense index of a state (as in
+// kripke.csr()) is written in `bits` boolean variables, most significant
+// first; current-state bit i is BDD variable 2i and next-state bit i is
+// variable 2i+1, so moving a set to next-state variables is a shift by one.
+class SymbolicKripke {
+   public:
+    explicit SymbolicKripke(const Kripke& kripke) {
+        const CSRGraph& G = kripke.csr();
+        _size = G.size();
+        _bits = 1;
+        while (_bits < 31 && (1 << _bits) < _size) {
+            _bits++;
+        }
+        _mgr.reset(new BDDManager(2 * _bits));
+        for (int i = 0; i < _bits; i++) {
+            _current.push_back(2 * i);
+            _next.push_back(2 * i + 1);
+        }
+        _next_cube = _mgr->cube(_next);
+        _states = _mgr->less_than(_size, _current);
+
+        std::vector<int> all_vars;
+        for (int v = 0; v < 2 * _bits; v++) {
+            all_vars.push_back(v);
+        }
+        std::vector<std::uint64_t> keys;
+        keys.reserve(G.num_edges());
+        for (int v = 0; v < G.size(); v++) {
+            for (int w : G.successors(v)) {
+                keys.push_back(interleave(v, w));
+            }
+        }
+        std::sort(keys.begin(), keys.end());
+        _transitions = _mgr->from_minterms(keys, all_vars);
+    }
+
+    BDDManager& manager() { return *_mgr; }
+
+    int size() const { return _size; }
+
+    int bits() const { return _bits; }
+
+    // Encodings of the states of the structure.
+    const BDD& states() const { return _states; }
+
+    // The transition relation over current- and next-state variables.
+    const BDD& transitions() const { return _transitions; }
+
+    BDD encode(const StateSet& S) {
+        std::vector<std::uint64_t> keys;
+        keys.reserve(S.count());
+        S.for_each([&](int v) { keys.push_back(v); });
+        return _mgr->from_minterms(keys, _current);
+    }
+
+    StateSet decode(const BDD& S) {
+        StateSet result(_size);
+        _mgr->for_each_minterm(S, _current, [&](std::uint64_t v) {
+            if (v < std::uint64_t(_size)) {
+                result.insert(v);
+            }
+        });
+        return result;
+    }
+
+    // States with a successor in S.
+    BDD pre(const BDD& S) {
+        return _mgr->and_exists(_transitions, _mgr->shift(S, 1), _next_cube);
+    }
+
+   private:
+    // Declared first so that it outlives the BDD members.
+    std::unique_ptr<BDDManager> _mgr;
+    int _size;
+    int _bits;
+    std::vector<int> _current;
+    std::vector<int> _next;
+    BDD _next_cube;
+    BDD _states;
+    BDD _transitions;
+
+    std::uint64_t interleave(std::uint64_t v, std::uint64_t w) const {
+        std::uint64_t key = 0;
+        for (int i = _bits - 1; i >= 0; i--) {
+            key = (key << 2) | (((v >> i) & 1) << 1) | ((w >> i) & 1);
+        }
+        return key;
+    }
+};
+
+// Evaluates interned formulas on a SymbolicKripke by pre-image fixpoints.
+// Results are cached per formula id for the lifetime of the checker. With
+// fairness constraints F, path quantifiers range over fair paths only (those
+// visiting every set of F infinitely often), and fair EG is computed by the
+// Emerson-Lei fixpoint.
+class SymbolicChecker {
+   public:
+    SymbolicChecker(const Kripke& kripke, FormulaTable& formulas,
+                    const std::vector<std::unordered_set<int>>& F = {})
+        : _kripke(kripke), _model(kripke), _formulas(formulas) {
+        const CSRGraph& G = kripke.csr();
+        for (const auto& P : F) {
+            StateSet S(G.size());
+            for (int s : P) {
+                if (G.contains(s)) {
+                    S.insert(G.index(s));
+                }
+            }
+            _fairness.push_back(_model.encode(S));
+        }
+        _fair = _fairness.empty() ? _model.states() : _fairEG(_model.states());
+    }
+
+    SymbolicKripke& model() { return _model; }
+
+    // States from which some fair path starts.
+    const BDD& fair_states() const { return _fair; }
+
+    BDD check(int id) {
+        if (id < int(_computed.size()) && _computed[id]) {
+            return _sets[id];
+        }
+
+        BDD result = _evaluate(id);
+        if (id >= int(_computed.size())) {
+            _computed.resize(_formulas.size(), 0);
+            _sets.resize(_formulas.size());
+        }
+        _sets[id] = result;
+        _computed[id] = 1;
+        return result;
+    }
+
+   private:
+    const Kripke& _kripke;
+    SymbolicKripke _model;
+    FormulaTable& _formulas;
+    std::vector<BDD> _fairness;
+    BDD _fair;
+    std::vector<BDD> _sets;
+    std::vector<char> _computed;
+
+    BDD _evaluate(int id) {
+        FormulaNode node = _formulas.node(id);
+        switch (node.opcode) {
+            case (OpCode::Not): {
+                return _model.states() & !check(node.left);
+            }
+            case (OpCode::Or): {
+                return check(node.left) | check(node.right);
+            }
+            case (OpCode::Bool): {
+                return node.ap ? _model.states() : _model.manager().zero();
+            }
+            case (OpCode::Atomic): {
+                return _checkAP(node.ap);
+            }
+            case (OpCode::E): {
+                FormulaNode path = _formulas.node(node.left);
+                switch (path.opcode) {
+                    case (OpCode::G): {
+                        return _fairEG(check(path.left));
+                    }
+                    case (OpCode::U): {
+                        BDD phi = check(path.left);
+                        return _checkEU(phi, check(path.right) & _fair);
+                    }
+                    case (OpCode::X): {
+                        return _model.pre(check(path.left) & _fair);
+                    }
+                }
+            }
+        }
+        return check(_formulas.restricted(id));
+    }
+
+    BDD _checkAP(int ap) {
+        const StateSet* S = _kripke.ap_states(_formulas.ap_name(ap));
+        if (S == nullptr) {
+            return _model.manager().zero();
+        }
+        return _model.encode(*S) & _fair;
+    }
+
+    // Least fixpoint Z = chi | (phi & EX Z).
+    BDD _checkEU(const BDD& phi, const BDD& chi) {
+        BDD Z = chi;
+        BDD frontier = chi;
+        while (!frontier.is_zero()) {
+            BDD next = Z | (phi & _model.pre(frontier));
+            frontier = next & !Z;
+            Z = next;
+        }
+        return Z;
+    }
+
+    // Greatest fixpoint Z = phi & EX Z.
+    BDD _checkEG(const BDD& phi) {
+        BDD Z = phi;
+        while (true) {
+            BDD next = Z & _model.pre(Z);
+            if (next == Z) {
+                return Z;
+            }
+            Z = next;
+        }
+    }
+
+    // Emerson-Lei: Z = phi & AND_k EX E[phi U (Z & F_k)].
+    BDD _fairEG(const BDD& phi) {
+        if (_fairness.empty()) {
+            return _checkEG(phi);
+        }
+        BDD Z = phi;
+        while (true) {
+            BDD next = Z;
+            for (const BDD& P : _fairness) {
+                next = next & _model.pre(_checkEU(phi, Z & P));
+            }
+            if (next == Z) {
+                return Z;
+            }
+            Z = next;
+        }
+    }
+};
@@ -0,0 +1,562 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "graph.h"
+#include "kripke.h"
+#include "kripke_file.h"
+#include "threadpool.h"
+
+// Text models are an edge file with one "src dst" transition per line and an
+// optional label file with one "state ap ap ..." line per state. Blank lines
+// and lines starting with '#' are ignored. States are arbitrary ints; every
+// state mentioned in either file becomes a state of the structure.
+struct LoadOptions {
+    int num_threads = 0;
+    ThreadPool* pool = nullptr;
+};
+
+struct LoadStats {
+    std::size_t bytes = 0;
+    std::size_t states = 0;
+    std::size_t edges = 0;
+    double seconds = 0;
+
+    double bytes_per_second() const {
+        return seconds > 0 ? bytes / seconds : 0;
+    }
+    double edges_per_second() const {
+        return seconds > 0 ? edges / seconds : 0;
+    }
+};
+
+// Byte ranges of a file that each start at the beginning of a line.
+inline std::vector<std::pair<const char*, const char*>> _splitLines(
+    const char* first, const char* last, int chunks) {
+    std::vector<std::pair<const char*, const char*>> result;
+    const char* begin = first;
+    for (int k = 1; k <= chunks && begin < last; k++) {
+        const char* end = first + (last - first) * k / chunks;
+        end = std::max(end, begin);
+        while (end < last && *end != '\n') {
+            end++;
+        }
+        if (end < last) {
+            end++;
+        }
+        result.push_back(std::make_pair(begin, end));
+        begin = end;
+    }
+    return result;
+}
+
+inline bool _skipBlanks(const char*& p, const char* last) {
+    while (p < last && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        p++;
+    }
+    return p < last && *p != '\n';
+}
+
+[[noreturn]] inline void _parseError(const char* what, const char* p,
+                                     const char* base) {
+    throw std::runtime_error(std::string(what) + " at byte " +
+                             std::to_string(p - base));
+}
+
+inline int _parseInt(const char*& p, const char* last, const char* base) {
+    bool negative = p < last && *p == '-';
+    if (negative) {
+        p++;
+    }
+    if (p == last || unsigned(*p - '0') > 9) {
+        _parseError("Expected a state", p, base);
+    }
+    // Ten digits cannot overflow the accumulator; more are out of range.
+    std::int64_t value = 0;
+    const char* start = p;
+    while (p < last && unsigned(*p - '0') <= 9) {
+        if (p - start == 10) {
+            _parseError("State out of range", p, base);
+        }
+        value = value * 10 + (*p++ - '0');
+    }
+    value = negative ? -value : value;
+    if (value > INT32_MAX || value < INT32_MIN) {
+        _parseError("State out of range", p, base);
+    }
+    return value;
+}
+
+// Calls f(src, dst) for every transition in [first, last).
+template <typename Fn>
+inline void _parseEdges(const char* first, const char* last, const char* base,
+                        Fn f) {
+    const char* p = first;
+    while (p < last) {
+        if (_skipBlanks(p, last) && *p != '#') {
+            int src = _parseInt(p, last, base);
+            _skipBlanks(p, last);
+            int dst = _parseInt(p, last, base);
+            if (_skipBlanks(p, last)) {
+                _parseError("Trailing characters", p, base);
+            }
+            f(src, dst);
+        }
+        while (p < last && *p != '\n') {
+            p++;
+        }
+        if (p < last) {
+            p++;
+        }
+    }
+}
+
+// Calls f(state, ap_first, ap_last) for every label in [first, last), and
+// f(state, nullptr, nullptr) for every line.
+template <typename Fn>
+inline void _parseLabels(const char* first, const char* last, const char* base,
+                         Fn f) {
+    const char* p = first;
+    while (p < last) {
+        if (_skipBlanks(p, last) && *p != '#') {
+            int state = _parseInt(p, last, base);
+            f(state, nullptr, nullptr);
+            while (_skipBlanks(p, last)) {
+                const char* ap = p;
+                while (p < last && *p != ' ' && *p != '\t' && *p != '\r' &&
+                       *p != '\n') {
+                    p++;
+                }
+                f(state, ap, p);
+            }
+        }
+        while (p < last && *p != '\n') {
+            p++;
+        }
+        if (p < last) {
+            p++;
+        }
+    }
+}
+
+// Maps the state ids seen in the input to dense indices in increasing id
+// order. Ids are marked concurrently in a flat bitmap over [min, max] when
+// that bitmap is no larger than the input, and otherwise in a radix tree
+// over the 32-bit offsets from min: three levels of 256 children each, then
+// leaves of 256 bits, allocated when first marked. finish() ranks the words
+// of the bitmap, or the leaves of the tree, so that an index is a popcount
+// away.
+class _DenseIds {
+   public:
+    _DenseIds() : _root(new _Node()) {}
+    ~_DenseIds() { _free(_root, 0); }
+
+    _DenseIds(const _DenseIds&) = delete;
+    _DenseIds& operator=(const _DenseIds&) = delete;
+
+    void reset(std::int64_t min, std::int64_t max, std::size_t mentions) {
+        _min = min;
+        _bitmap = max >= min && std::uint64_t(max - min) / 64 <= mentions;
+        if (_bitmap) {
+            std::size_t words = (max - min) / 64 + 1;
+            _bits = std::vector<std::atomic<std::uint64_t>>(words);
+        }
+    }
+
+    // May be called concurrently.
+    void mark(int id) {
+        std::uint64_t k = std::int64_t(id) - _min;
+        std::atomic<std::uint64_t>* words =
+            _bitmap ? &_bits[k / 64] : _leaf(k, true)->bits + k % 256 / 64;
+        words->fetch_or(std::uint64_t(1) << (k % 64),
+                        std::memory_order_relaxed);
+    }
+
+    void finish() {
+        if (_bitmap) {
+            _rank.resize(_bits.size() + 1, 0);
+            for (std::size_t i = 0; i < _bits.size(); i++) {
+                std::uint64_t w = _bits[i].load(std::memory_order_relaxed);
+                _rank[i + 1] = _rank[i] + __builtin_popcountll(w);
+                _append(64 * i, w);
+            }
+            return;
+        }
+        _finish(_root, 0, 0);
+    }
+
+    // The index of a marked id.
+    int index(int id) const {
+        std::uint64_t k = std::int64_t(id) - _min;
+        const std::atomic<std::uint64_t>* words;
+        int rank;
+        if (_bitmap) {
+            words = &_bits[k / 64];
+            rank = _rank[k / 64];
+        } else {
+            const _Leaf* leaf = _leaf(k, false);
+            words = leaf->bits;
+            rank = leaf->rank;
+            for (std::uint64_t i = 0; i < k % 256 / 64; i++) {
+                rank += __builtin_popcountll(
+                    words[i].load(std::memory_order_relaxed));
+            }
+            words += k % 256 / 64;
+        }
+        std::uint64_t w = words->load(std::memory_order_relaxed);
+        std::uint64_t below = w & ((std::uint64_t(1) << (k % 64)) - 1);
+        return rank + __builtin_popcountll(below);
+    }
+
+    const std::vector<int>& ids() const { return _ids; }
+
+   private:
+    struct _Node {
+        std::atomic<void*> children[256];
+        _Node() {
+            for (std::atomic<void*>& child : children) {
+                child.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    struct _Leaf {
+        std::atomic<std::uint64_t> bits[4];
+        int rank = 0;
+        _Leaf() {
+            for (std::atomic<std::uint64_t>& w : bits) {
+                w.store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    // The leaf of offset k, created along with its path if `create`.
+    _Leaf* _leaf(std::uint64_t k, bool create) const {
+        _Node* node = _root;
+        for (int level = 0; level < 3; level++) {
+            std::atomic<void*>& slot =
+                node->children[(k >> (24 - 8 * level)) & 255];
+            void* child = slot.load(std::memory_order_acquire);
+            if (child == nullptr && create) {
+                void* fresh = level < 2 ? static_cast<void*>(new _Node())
+                                        : static_cast<void*>(new _Leaf());
+                if (slot.compare_exchange_strong(child, fresh,
+                                                 std::memory_order_acq_rel)) {
+                    child = fresh;
+                } else if (level < 2) {
+                    delete static_cast<_Node*>(fresh);
+                } else {
+                    delete static_cast<_Leaf*>(fresh);
+                }
+            }
+            if (level == 2) {
+                return static_cast<_Leaf*>(child);
+            }
+            node = static_cast<_Node*>(child);
+        }
+        return nullptr;
+    }
+
+    void _append(std::uint64_t first, std::uint64_t w) {
+        for (; w != 0; w &= w - 1) {
+            _ids.push_back(_min + first + __builtin_ctzll(w));
+        }
+    }
+
+    void _finish(_Node* node, int level, std::uint64_t prefix) {
+        for (int c = 0; c < 256; c++) {
+            void* child = node->children[c].load(std::memory_order_relaxed);
+            if (child == nullptr) {
+                continue;
+            }
+            std::uint64_t first = (prefix << 8) | c;
+            if (level < 2) {
+                _finish(static_cast<_Node*>(child), level + 1, first);
+                continue;
+            }
+            _Leaf* leaf = static_cast<_Leaf*>(child);
+            leaf->rank = _ids.size();
+            for (int i = 0; i < 4; i++) {
+                _append(256 * first + 64 * i,
+                        leaf->bits[i].load(std::memory_order_relaxed));
+            }
+        }
+    }
+
+    static void _free(_Node* node, int level) {
+        for (std::atomic<void*>& slot : node->children) {
+            void* child = slot.load(std::memory_order_relaxed);
+            if (child != nullptr && level < 2) {
+                _free(static_cast<_Node*>(child), level + 1);
+            } else if (child != nullptr) {
+                delete static_cast<_Leaf*>(child);
+            }
+        }
+        delete node;
+    }
+
+    std::int64_t _min;
+    bool _bitmap;
+    std::vector<std::atomic<std::uint64_t>> _bits;
+    std::vector<int> _rank;
+    _Node* _root;
+    std::vector<int> _ids;
+};
+
+template <typename Body>
+inline void _forEachChunk(ThreadPool& pool, std::size_t n, Body body) {
+    TaskGroup group(pool);
+    for (std::size_t k = 0; k < n; k++) {
+        group.run([&body, k] { body(k); });
+    }
+    group.wait();
+}
+
+inline Kripke _loadTextKripke(const std::string& edges_path,
+                              const std::string& labels_path,
+                              const std::unordered_set<int>& S0,
+                              LoadStats* stats, ThreadPool& pool) {
+    auto start = std::chrono::steady_clock::now();
+    MappedFile edges_file(edges_path);
+    std::unique_ptr<MappedFile> labels_file;
+    if (!labels_path.empty()) {
+        labels_file.reset(new MappedFile(labels_path));
+    }
+
+    const char* ebase = edges_file.data();
+    auto echunks = _splitLines(ebase, ebase + edges_file.size(),
+                               4 * pool.size());
+    std::vector<std::pair<const char*, const char*>> lchunks;
+    const char* lbase = nullptr;
+    if (labels_file) {
+        lbase = labels_file->data();
+        lchunks = _splitLines(lbase, lbase + labels_file->size(),
+                              4 * pool.size());
+    }
+
+    // Pass 1: bounds of the state ids and the number of transitions.
+    std::int64_t min = INT32_MAX, max = INT32_MIN;
+    std::size_t num_edges = 0, mentions = S0.size();
+    std::mutex bounds_mutex;
+    auto merge_bounds = [&](std::int64_t lo, std::int64_t hi, std::size_t m,
+                            std::size_t e) {
+        std::lock_guard<std::mutex> lock(bounds_mutex);
+        min = std::min(min, lo);
+        max = std::max(max, hi);
+        mentions += m;
+        num_edges += e;
+    };
+    _forEachChunk(pool, echunks.size(), [&](std::size_t k) {
+        std::int64_t lo = INT32_MAX, hi = INT32_MIN;
+        std::size_t e = 0;
+        _parseEdges(echunks[k].first, echunks[k].second, ebase,
+                    [&](int src, int dst) {
+                        lo = std::min<std::int64_t>(lo, std::min(src, dst));
+                        hi = std::max<std::int64_t>(hi, std::max(src, dst));
+                        e++;
+                    });
+        merge_bounds(lo, hi, 2 * e, e);
+    });
+    _forEachChunk(pool, lchunks.size(), [&](std::size_t k) {
+        std::int64_t lo = INT32_MAX, hi = INT32_MIN;
+        std::size_t m = 0;
+        _parseLabels(lchunks[k].first, lchunks[k].second, lbase,
+                     [&](int s, const char* ap, const char*) {
+                         if (ap == nullptr) {
+                             lo = std::min<std::int64_t>(lo, s);
+                             hi = std::max<std::int64_t>(hi, s);
+                             m++;
+                         }
+                     });
+        merge_bounds(lo, hi, m, 0);
+    });
+    for (int s : S0) {
+        min = std::min<std::int64_t>(min, s);
+        max = std::max<std::int64_t>(max, s);
+    }
+
+    // Pass 2: the set of state ids, numbered in increasing order.
+    _DenseIds dense;
+    dense.reset(min, max, mentions);
+    _forEachChunk(pool, echunks.size(), [&](std::size_t k) {
+        _parseEdges(echunks[k].first, echunks[k].second, ebase,
+                    [&](int src, int dst) {
+                        dense.mark(src);
+                        dense.mark(dst);
+                    });
+    });
+    _forEachChunk(pool, lchunks.size(), [&](std::size_t k) {
+        _parseLabels(lchunks[k].first, lchunks[k].second, lbase,
+                     [&](int s, const char*, const char*) { dense.mark(s); });
+    });
+    for (int s : S0) {
+        dense.mark(s);
+    }
+    dense.finish();
+    const int n = dense.ids().size();
+
+    // Pass 3: out-degrees, and from them the row offsets.
+    auto arrays = std::make_shared<CSRArrays>();
+    arrays->ids = dense.ids();
+    std::vector<std::atomic<std::size_t>> cursor(n);
+    _forEachChunk(pool, echunks.size(), [&](std::size_t k) {
+        _parseEdges(echunks[k].first, echunks[k].second, ebase,
+                    [&](int src, int) {
+                        cursor[dense.index(src)].fetch_add(
+                            1, std::memory_order_relaxed);
+                    });
+    });
+    std::vector<std::size_t>& offsets = arrays->offsets;
+    offsets.assign(n + 1, 0);
+    for (int v = 0; v < n; v++) {
+        std::size_t degree = cursor[v].load(std::memory_order_relaxed);
+        offsets[v + 1] = offsets[v] + degree;
+        cursor[v].store(offsets[v], std::memory_order_relaxed);
+    }
+
+    // Pass 4: targets, written straight into their rows.
+    std::vector<int>& targets = arrays->targets;
+    targets.resize(num_edges);
+    _forEachChunk(pool, echunks.size(), [&](std::size_t k) {
+        _parseEdges(echunks[k].first, echunks[k].second, ebase,
+                    [&](int src, int dst) {
+                        std::size_t at = cursor[dense.index(src)].fetch_add(
+                            1, std::memory_order_relaxed);
+                        targets[at] = dense.index(dst);
+                    });
+    });
+    std::vector<std::atomic<std::size_t>>().swap(cursor);
+
+    // Rows are sorted in parallel, then duplicate transitions are dropped.
+    std::vector<std::size_t> unique(n, 0);
+    const std::size_t rows_per_chunk = std::max<std::size_t>(
+        1, (n + 4 * pool.size() - 1) / (4 * pool.size()));
+    _forEachChunk(pool, (n + rows_per_chunk - 1) / rows_per_chunk,
+                  [&](std::size_t k) {
+                      std::size_t last = std::min<std::size_t>(
+                          n, (k + 1) * rows_per_chunk);
+                      for (std::size_t v = k * rows_per_chunk; v < last; v++) {
+                          int* first = targets.data() + offsets[v];
+                          int* end = targets.data() + offsets[v + 1];
+                          std::sort(first, end);
+                          unique[v] = std::unique(first, end) - first;
+                      }
+                  });
+    std::size_t out = 0;
+    for (int v = 0; v < n; v++) {
+        std::size_t first = offsets[v];
+        offsets[v] = out;
+        if (out != first) {
+            std::copy(targets.begin() + first,
+                      targets.begin() + first + unique[v],
+                      targets.begin() + out);
+        }
+        out += unique[v];
+    }
+    offsets[n] = out;
+    targets.resize(out);
+    targets.shrink_to_fit();
+
+    // Labels are set straight into one shared column per AP. Chunks intern
+    // APs through a local cache; APs are then numbered in the order they
+    // first appear in the file, as chunks are.
+    const std::size_t words = (n + 63) / 64;
+    std::vector<std::unique_ptr<std::atomic<std::uint64_t>[]>> shared;
+    std::unordered_map<std::string, int> shared_ids;
+    std::mutex ap_mutex;
+    std::vector<std::vector<int>> chunk_aps(lchunks.size());
+    _forEachChunk(pool, lchunks.size(), [&](std::size_t k) {
+        std::unordered_map<std::string, std::atomic<std::uint64_t>*> cache;
+        _parseLabels(
+            lchunks[k].first, lchunks[k].second, lbase,
+            [&](int s, const char* first, const char* last) {
+                if (first == nullptr) {
+                    return;
+                }
+                std::string ap(first, last);
+                auto found = cache.find(ap);
+                if (found == cache.end()) {
+                    std::lock_guard<std::mutex> lock(ap_mutex);
+                    auto id = shared_ids.emplace(ap, shared.size());
+                    if (id.second) {
+                        shared.emplace_back(
+                            new std::atomic<std::uint64_t>[words]());
+                    }
+                    chunk_aps[k].push_back(id.first->second);
+                    found = cache.emplace(ap, shared[id.first->second].get())
+                                .first;
+                }
+                int v = dense.index(s);
+                found->second[v / 64].fetch_or(std::uint64_t(1) << (v % 64),
+                                               std::memory_order_relaxed);
+            });
+    });
+    std::vector<std::string> aps(shared.size());
+    for (const auto& ap : shared_ids) {
+        aps[ap.second] = ap.first;
+    }
+    std::vector<std::string> ordered_aps;
+    std::vector<StateSet> columns;
+    std::vector<bool> seen(shared.size(), false);
+    std::vector<std::uint64_t> column(words);
+    for (const std::vector<int>& chunk : chunk_aps) {
+        for (int a : chunk) {
+            if (seen[a]) {
+                continue;
+            }
+            seen[a] = true;
+            for (std::size_t i = 0; i < words; i++) {
+                column[i] = shared[a][i].load(std::memory_order_relaxed);
+            }
+            ordered_aps.push_back(std::move(aps[a]));
+            columns.emplace_back(n, column.data());
+            shared[a].reset();
+        }
+    }
+
+    // The ids are sorted, so the graph needs no index of them.
+    CSRGraph G(arrays, n, arrays->ids.data(), arrays->offsets.data(),
+               arrays->targets.data(), true);
+    Kripke kripke(std::move(G), S0, std::move(ordered_aps),
+                  std::move(columns));
+
+    if (stats != nullptr) {
+        stats->bytes = edges_file.size();
+        if (labels_file) {
+            stats->bytes += labels_file->size();
+        }
+        stats->states = n;
+        stats->edges = out;
+        stats->seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+    }
+    return kripke;
+}
+
+// Loads a text model in parallel chunks. The edge file is parsed in four
+// passes (id bounds, id set, out-degrees, targets) so the CSR arrays are
+// allocated once at their final size and filled in place; duplicate
+// transitions are dropped. If `stats` is given it receives the input size
+// and the time taken.
+inline Kripke load_text_kripke(const std::string& edges_path,
+                               const std::string& labels_path,
+                               const std::unordered_set<int>& S0,
+                               LoadStats* stats = nullptr,
+                               const LoadOptions& options = LoadOptions()) {
+    if (options.pool != nullptr) {
+        return _loadTextKripke(edges_path, labels_path, S0, stats,
+                               *options.pool);
+    }
+    ThreadPool pool(options.num_threads);
+    return _loadTextKripke(edges_path, labels_path, S0, stats, pool);
+}
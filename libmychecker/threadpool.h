@@ -0,0 +1,192 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed-size work-stealing pool. A pool of size n runs n-1 workers, each
+// with its own deque: tasks submitted by a worker go to the back of its deque
+// and are popped from there (LIFO, for locality), while idle workers steal
+// from the front of the others. Tasks submitted from outside the pool go to a
+// shared queue. The thread waiting on a TaskGroup executes queued tasks as
+// well, so a pool of size 1 runs everything inline and nested waits never
+// deadlock.
+class ThreadPool {
+   public:
+    explicit ThreadPool(int num_threads) : _queued(0), _stop(false) {
+        if (num_threads <= 0) {
+            num_threads = std::thread::hardware_concurrency();
+        }
+        for (int i = 0; i < std::max(num_threads, 1); i++) {
+            _queues.emplace_back(new Queue());
+        }
+        for (int i = 1; i < num_threads; i++) {
+            _workers.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(_sleep_mutex);
+            _stop = true;
+        }
+        _cv.notify_all();
+        for (std::thread& t : _workers) {
+            t.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return _workers.size() + 1; }
+
+    void submit(std::function<void()> task) {
+        Queue& q = *_queues[self()];
+        {
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.tasks.push_back(std::move(task));
+        }
+        _queued++;
+        {
+            std::lock_guard<std::mutex> lock(_sleep_mutex);
+        }
+        _cv.notify_one();
+    }
+
+    // Runs one queued task on the calling thread, if there is any.
+    bool run_pending_task() {
+        std::function<void()> task;
+        if (!pop(self(), task)) {
+            return false;
+        }
+        task();
+        return true;
+    }
+
+   private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // Queue 0 is shared by all threads outside the pool; queue i > 0 belongs
+    // to worker i.
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _workers;
+    std::atomic<int> _queued;
+    std::mutex _sleep_mutex;
+    std::condition_variable _cv;
+    bool _stop;
+
+    struct WorkerSlot {
+        const ThreadPool* pool = nullptr;
+        int index = 0;
+    };
+
+    static WorkerSlot& current_worker() {
+        thread_local WorkerSlot slot;
+        return slot;
+    }
+
+    int self() const {
+        const WorkerSlot& slot = current_worker();
+        return slot.pool == this ? slot.index : 0;
+    }
+
+    bool pop(int self, std::function<void()>& task) {
+        int n = _queues.size();
+        for (int k = 0; k < n; k++) {
+            int i = (self + k) % n;
+            Queue& q = *_queues[i];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.tasks.empty()) {
+                continue;
+            }
+            if (i == self && self != 0) {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+            } else {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+            _queued--;
+            return true;
+        }
+        return false;
+    }
+
+    void work(int index) {
+        current_worker().pool = this;
+        current_worker().index = index;
+        std::function<void()> task;
+        while (true) {
+            if (pop(index, task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(_sleep_mutex);
+            _cv.wait(lock, [this] { return _stop || _queued.load() > 0; });
+            if (_stop && _queued.load() == 0) {
+                return;
+            }
+        }
+    }
+};
+
+// Tracks a set of tasks submitted to a ThreadPool. Tasks may add further
+// tasks to the same group; wait() returns once all of them have finished and
+// rethrows the first exception any of them raised.
+class TaskGroup {
+   public:
+    explicit TaskGroup(ThreadPool& pool) : _pool(pool), _pending(0) {}
+
+    ~TaskGroup() {
+        while (_pending.load() != 0) {
+            if (!_pool.run_pending_task()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void run(std::function<void()> task) {
+        _pending++;
+        _pool.submit([this, task] {
+            try {
+                task();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (!_error) {
+                    _error = std::current_exception();
+                }
+            }
+            _pending--;
+        });
+    }
+
+    void wait() {
+        while (_pending.load() != 0) {
+            if (!_pool.run_pending_task()) {
+                std::this_thread::yield();
+            }
+        }
+        if (_error) {
+            std::exception_ptr error = _error;
+            _error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+   private:
+    ThreadPool& _pool;
+    std::atomic<int> _pending;
+    std::mutex _mutex;
+    std::exception_ptr _error;
+};
@@ -0,0 +1,133 @@
+#pragma once
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "checker.h"
+#include "graph.h"
+#include "kripke.h"
+#include "stateset.h"
+
+// A path of dense state indices. If loop != -1 the path is a lasso: after
+// its last state it continues at states[loop], forever.
+struct Trace {
+    std::vector<int> states;
+    int loop = -1;
+};
+
+Trace witness(Kripke& kripke, Labelling& L, int id, int v);
+Trace counterexample(Kripke& kripke, Labelling& L, int id, int v);
+
+// A lasso from v through the result of the fair EG formula `id`: next leads
+// v to the entry of a fair SCC, and the cycle recorded for that entry visits
+// every fairness set of L.
+inline Trace _fairLasso(Kripke& kripke, const Labelling& L, int id, int v) {
+    const std::vector<int>& next = L.next(id);
+    Trace trace;
+    int w = v;
+    for (; next[w] != -1; w = next[w]) {
+        trace.states.push_back(w);
+    }
+    IndexRange cycle = L.cycles(id).cycle(w);
+    if (cycle.empty()) {
+        throw std::runtime_error("No fair cycle recorded for " +
+                                 L.formulas.str(id) + " in state " +
+                                 std::to_string(kripke.csr().id(v)));
+    }
+    trace.loop = trace.states.size();
+    trace.states.insert(trace.states.end(), cycle.begin(), cycle.end());
+    return trace;
+}
+
+// A path from v showing that formula `id` holds in v: a shortest path to
+// the goal for EU, a lasso for EG (one whose cycle visits every fairness
+// set, if any), a step for EX, and just v for other formulas. L must
+// have been filled by the Explicit engine with options.witnesses set.
+inline Trace witness(Kripke& kripke, Labelling& L, int id, int v) {
+    if (!L.at(id).contains(v)) {
+        throw std::runtime_error(L.formulas.str(id) + " does not hold in " +
+                                 std::to_string(kripke.csr().id(v)));
+    }
+    const FormulaNode& node = L.formulas.node(id);
+    Trace trace;
+    switch (node.opcode) {
+        case (OpCode::Not): {
+            return counterexample(kripke, L, node.left, v);
+        }
+        case (OpCode::Or): {
+            int phi = L.at(node.left).contains(v) ? node.left : node.right;
+            return witness(kripke, L, phi, v);
+        }
+        case (OpCode::Bool):
+        case (OpCode::Atomic): {
+            trace.states.push_back(v);
+            return trace;
+        }
+        case (OpCode::E): {
+            const FormulaNode& path = L.formulas.node(node.left);
+            switch (path.opcode) {
+                case (OpCode::X): {
+                    trace.states.push_back(v);
+                    for (int w : kripke.csr().successors(v)) {
+                        if (L.at(path.left).contains(w) &&
+                            (L.fairness.empty() || L.fair.contains(w))) {
+                            trace.states.push_back(w);
+                            break;
+                        }
+                    }
+                    return trace;
+                }
+                case (OpCode::U):
+                case (OpCode::G): {
+                    const std::vector<int>& next = L.next(id);
+                    if (next.empty()) {
+                        throw std::runtime_error(
+                            "No witness recorded for " + L.formulas.str(id));
+                    }
+                    if (path.opcode == OpCode::G && !L.fairness.empty()) {
+                        return _fairLasso(kripke, L, id, v);
+                    }
+                    std::unordered_map<int, int> position;
+                    for (int w = v; w != -1; w = next[w]) {
+                        auto found = position.emplace(w, trace.states.size());
+                        if (!found.second) {
+                            trace.loop = found.first->second;
+                            break;
+                        }
+                        trace.states.push_back(w);
+                    }
+                    return trace;
+                }
+            }
+        }
+    }
+    return witness(kripke, L, L.formulas.restricted(id), v);
+}
+
+// A path from v showing that formula `id` fails in v. Only failures of
+// universal properties have a path; for those, it is the witness of the
+// negated existential formula (e.g. a path to a bad state for AG). For
+// other formulas the trace is just v.
+inline Trace counterexample(Kripke& kripke, Labelling& L, int id, int v) {
+    if (L.at(id).contains(v)) {
+        throw std::runtime_error(L.formulas.str(id) + " holds in " +
+                                 std::to_string(kripke.csr().id(v)));
+    }
+    const FormulaNode& node = L.formulas.node(id);
+    switch (node.opcode) {
+        case (OpCode::Not): {
+            return witness(kripke, L, node.left, v);
+        }
+        case (OpCode::Or): {
+            return counterexample(kripke, L, node.left, v);
+        }
+        case (OpCode::Bool):
+        case (OpCode::Atomic):
+        case (OpCode::E): {
+            Trace trace;
+            trace.states.push_back(v);
+            return trace;
+        }
+    }
+    return counterexample(kripke, L, L.formulas.restricted(id), v);
+}
@@ -0,0 +1,235 @@
+#include <functional>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "libmychecker/checker.h"
+#include "libmychecker/implicit.h"
+#include "libmychecker/local.h"
+#include "libmychecker/models.h"
+#include "libmychecker/profiler.h"
+#include "tests/test_util.h"
+
+// Checks every engine and option against the sequential Explicit checker on
+// random models: each configuration checks the same formulas with one
+// Labelling per model, so later formulas reuse (or recompute) the results
+// of earlier ones.
+
+struct Configuration {
+    std::string name;
+    std::function<void(CheckOptions&, const Kripke&)> apply;
+};
+
+static void check_configurations(unsigned seed) {
+    TestRandom random(seed);
+    int n = seed % 25 == 0 ? 200 + random.below(200) : 1 + random.below(30);
+    bool fair = seed % 3 == 1;
+    ModelData m = random.model(n, random.below(3 * n + 1), seed % 2,
+                               fair ? 1 + random.below(2) : 0);
+    Kripke kripke = m.kripke();
+    if (seed % 4 == 0) {
+        kripke.freeze();
+    }
+    std::vector<std::unordered_set<int>> F = m.fairness;
+    std::vector<std::shared_ptr<Formula>> formulas;
+    for (int j = 0; j < 5; j++) {
+        formulas.push_back(random.formula(4));
+    }
+
+    Labelling reference;
+    std::vector<std::set<int>> expected;
+    for (const std::shared_ptr<Formula>& f : formulas) {
+        int id = modelcheck(kripke, f, reference, F);
+        expected.push_back(state_ids(kripke, reference.at(id)));
+    }
+
+    Profiler profiler;
+    ThreadPool pool(3);
+    std::vector<Configuration> configurations = {
+        {"symbolic",
+         [&](CheckOptions& o, const Kripke&) {
+             o.engine = CheckEngine::Symbolic;
+             o.profiler = &profiler;
+         }},
+        {"threads", [](CheckOptions& o, const Kripke&) { o.num_threads = 4; }},
+        {"pool", [&](CheckOptions& o, const Kripke&) { o.pool = &pool; }},
+        {"forward-backward",
+         [](CheckOptions& o, const Kripke&) {
+             o.scc.algorithm = SCCAlgorithm::ForwardBackward;
+             o.scc.num_threads = 2;
+         }},
+        {"forward-backward threads",
+         [](CheckOptions& o, const Kripke&) {
+             o.scc.algorithm = SCCAlgorithm::ForwardBackward;
+             o.num_threads = 3;
+         }},
+        {"witnesses",
+         [](CheckOptions& o, const Kripke&) { o.witnesses = true; }},
+        {"profiler",
+         [&](CheckOptions& o, const Kripke&) { o.profiler = &profiler; }},
+        {"free dead results",
+         [](CheckOptions& o, const Kripke&) {
+             o.free_dead_results = true;
+             o.num_threads = 2;
+         }},
+        // Room for the model, a handful of results and the EG scratch, so
+        // that checks evict earlier results; steps that do not fit throw.
+        {"memory budget",
+         [](CheckOptions& o, const Kripke& k) {
+             std::size_t n = k.csr().size();
+             o.memory_budget = k.bytes() + 12 * ((n + 63) / 64 * 8 + 4 * n) +
+                               8 * k.csr().num_edges();
+         }},
+    };
+
+    for (const Configuration& configuration : configurations) {
+        Labelling L;
+        kripke.csr();
+        kripke.predecessors();
+        configuration.apply(L.options, kripke);
+        for (std::size_t j = 0; j < formulas.size(); j++) {
+            test_context = "seed " + std::to_string(seed) + ", " +
+                           configuration.name + ": " + formulas[j]->str();
+            try {
+                int id = modelcheck(kripke, formulas[j], L, F);
+                CHECK(state_ids(kripke, L.at(id)) == expected[j]);
+            } catch (const MemoryBudgetExceeded&) {
+                CHECK(L.options.memory_budget != 0);
+            }
+        }
+    }
+
+    // The local checkers decide single states; fair path quantifiers fall
+    // back to the global check.
+    const CSRGraph& G = kripke.csr();
+    for (std::size_t j = 0; j < formulas.size(); j++) {
+        test_context = "seed " + std::to_string(seed) + ", local: " +
+                       formulas[j]->str();
+        bool initially = true;
+        for (int s : kripke.initial_states()) {
+            initially = initially && expected[j].count(s) != 0;
+        }
+        CHECK(modelcheck_initial(kripke, formulas[j], F) == initially);
+        if (fair) {
+            continue;
+        }
+        FormulaTable table;
+        int id = table.intern(formulas[j]);
+        LocalChecker local(kripke, table);
+        for (int v = 0; v < G.size(); v++) {
+            CHECK(local.holds(id, v) == (expected[j].count(G.id(v)) != 0));
+        }
+    }
+    if (fair) {
+        return;
+    }
+
+    // The same model given implicitly, with every state initial so that
+    // exploring it reaches all of them.
+    CallbackModel model(
+        [&](std::vector<ImplicitModel::State>& result) {
+            for (int v = 0; v < G.size(); v++) {
+                result.push_back(G.id(v));
+            }
+        },
+        [&](ImplicitModel::State s, std::vector<ImplicitModel::State>& r) {
+            for (int w : G.successors(G.index(s))) {
+                r.push_back(G.id(w));
+            }
+        },
+        [&](ImplicitModel::State s, const std::string& ap) {
+            return m.labels.at(s).count(ap) != 0;
+        });
+    ExploredModel explored(model);
+    Labelling L;
+    for (std::size_t j = 0; j < formulas.size(); j++) {
+        test_context = "seed " + std::to_string(seed) + ", implicit: " +
+                       formulas[j]->str();
+        int id = modelcheck(explored, formulas[j], L);
+        FormulaTable table;
+        int on_the_fly_id = table.intern(formulas[j]);
+        OnTheFlyChecker on_the_fly(model, table);
+        std::set<int> got;
+        for (int v = 0; v < explored.states().size(); v++) {
+            int s = explored.states().state(v);
+            if (L.at(id).contains(v)) {
+                got.insert(s);
+            }
+            CHECK(on_the_fly.holds_at(on_the_fly_id, s) ==
+                  L.at(id).contains(v));
+        }
+        CHECK(got == expected[j]);
+    }
+}
+
+// A budget that forces earlier results out, and one too small for anything.
+static void check_eviction() {
+    test_context = "eviction";
+    Kripke kripke = random_model(100000, 3, 5);
+    std::vector<std::unordered_set<int>> none;
+    auto p = std::make_shared<CTL::AtomicProposition>("p");
+    auto q = std::make_shared<CTL::AtomicProposition>("q");
+    Labelling L;
+    int eg = modelcheck(kripke, CTL::EG(p), L, none);
+    StateSet first = L[eg];
+    L.options.memory_budget = kripke.bytes() + 1640000;
+    int au = modelcheck(kripke, CTL::AU(p, q), L, none);
+    CHECK(!L.contains(eg));
+    CHECK(modelcheck(kripke, CTL::EG(p), L, none) == eg);
+    CHECK(L[eg] == first);
+
+    Labelling fresh;
+    CHECK(fresh[modelcheck(kripke, CTL::AU(p, q), fresh, none)] == L[au]);
+
+    L.options.memory_budget = 1000;
+    bool thrown = false;
+    try {
+        modelcheck(kripke, CTL::EF(q), L, none);
+    } catch (const MemoryBudgetExceeded&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+// The Symbolic engine rejects the options it cannot honour, and reports
+// its checks to the profiler.
+static void check_symbolic_options() {
+    test_context = "symbolic options";
+    Kripke kripke = random_model(50, 3, 1);
+    std::vector<std::unordered_set<int>> none;
+    auto p = std::make_shared<CTL::AtomicProposition>("p");
+    for (int k = 0; k < 2; k++) {
+        Labelling L;
+        L.options.engine = CheckEngine::Symbolic;
+        L.options.witnesses = k == 0;
+        L.options.memory_budget = k == 1 ? 1 << 30 : 0;
+        bool thrown = false;
+        try {
+            modelcheck(kripke, CTL::EG(p), L, none);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+
+    Profiler profiler;
+    Labelling L;
+    L.options.engine = CheckEngine::Symbolic;
+    L.options.profiler = &profiler;
+    modelcheck(kripke, CTL::EG(p), L, none);
+    modelcheck(kripke, CTL::EF(p), L, none);
+    CHECK(profiler.events().size() == 2 &&
+          profiler.events()[0].name == "symbolic");
+}
+
+int main() {
+    for (unsigned seed = 0; seed < 150; seed++) {
+        check_configurations(seed);
+    }
+    check_eviction();
+    check_symbolic_options();
+    return test_result();
+}
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "libmychecker/kripke.h"
+#include "libmychecker/models.h"
+#include "tests/test_util.h"
+
+// The DiGraph queries of a Kripke structure must not depend on whether it is
+// frozen, nor on whether it was built directly in CSR form.
+
+static std::set<std::pair<int, int>> edge_set(const DiGraph& G) {
+    std::vector<std::pair<int, int>> E;
+    G.edges(E);
+    return std::set<std::pair<int, int>>(E.begin(), E.end());
+}
+
+static std::vector<int> sorted_nodes(const DiGraph& G) {
+    std::vector<int> V;
+    G.nodes(V);
+    std::sort(V.begin(), V.end());
+    return V;
+}
+
+static void check_queries(const Kripke& thawed, const Kripke& frozen,
+                          const ModelData& m, TestRandom& random) {
+    std::vector<int> V, frozen_V;
+    thawed.nodes(V);
+    frozen.nodes(frozen_V);
+    std::sort(V.begin(), V.end());
+    std::sort(frozen_V.begin(), frozen_V.end());
+    CHECK(V == frozen_V);
+    CHECK(std::set<int>(V.begin(), V.end()) ==
+          std::set<int>(m.states.begin(), m.states.end()));
+
+    std::vector<std::pair<int, int>> E;
+    frozen.edges(E);
+    std::set<std::pair<int, int>> frozen_E(E.begin(), E.end());
+    CHECK(frozen_E == m.edges);
+
+    std::unordered_set<int> sources, frozen_sources;
+    thawed.sources(sources);
+    frozen.sources(frozen_sources);
+    CHECK(sources == frozen_sources);
+
+    std::unordered_set<int> subset;
+    for (int s : V) {
+        if (random.below(2) == 0) {
+            subset.insert(s);
+        }
+    }
+    DiGraph sub = thawed.get_subgraph(subset);
+    DiGraph frozen_sub = frozen.get_subgraph(subset);
+    CHECK(sorted_nodes(sub) == sorted_nodes(frozen_sub));
+    CHECK(edge_set(sub) == edge_set(frozen_sub));
+
+    DiGraph reversed = frozen.get_reversed_graph();
+    std::set<std::pair<int, int>> reversed_edges;
+    for (const auto& e : m.edges) {
+        reversed_edges.emplace(e.second, e.first);
+    }
+    CHECK(sorted_nodes(reversed) == V);
+    CHECK(edge_set(reversed) == reversed_edges);
+
+    std::unordered_set<int> from = {V[random.below(V.size())]};
+    CHECK(thawed.get_reachable_set_from(from) ==
+          frozen.get_reachable_set_from(from));
+    CHECK(thawed.to_string().size() == frozen.to_string().size());
+}
+
+int main() {
+    for (unsigned seed = 0; seed < 200; seed++) {
+        test_context = "seed " + std::to_string(seed);
+        TestRandom random(seed);
+        int n = 1 + random.below(seed % 10 == 0 ? 300 : 20);
+        ModelData m = random.model(n, random.below(3 * n + 1), seed % 2, 0);
+        Kripke thawed = m.kripke();
+        Kripke frozen = m.kripke();
+        frozen.freeze();
+        check_queries(thawed, frozen, m, random);
+    }
+
+    test_context = "ring";
+    Kripke ring = ring_model(10);
+    std::unordered_set<int> from = {3};
+    CHECK(ring.get_reachable_set_from(from).size() == 10);
+    std::vector<int> V;
+    ring.nodes(V);
+    CHECK(V.size() == 10);
+    return test_result();
+}
@@ -0,0 +1,191 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "libmychecker/checker.h"
+#include "libmychecker/kripke_file.h"
+#include "libmychecker/models.h"
+#include "tests/test_util.h"
+
+// Saves Kripke structures, loads them back and compares them; truncated and
+// corrupted copies of a file must be rejected when they are opened, if need
+// be with validation.
+
+static const char* path = "test_kripke_file.kripke";
+
+static std::string read_file(const std::string& name) {
+    std::ifstream in(name, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in),
+                       std::istreambuf_iterator<char>());
+}
+
+static void write_file(const std::string& name, const std::string& bytes) {
+    std::ofstream out(name, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size());
+}
+
+static std::set<std::pair<int, int>> transitions(const Kripke& kripke) {
+    std::vector<std::pair<int, int>> R;
+    kripke.transitions(R);
+    return std::set<std::pair<int, int>>(R.begin(), R.end());
+}
+
+static void check_round_trip(Kripke& kripke, TestRandom& random) {
+    save_kripke(kripke, path);
+    Kripke loaded = load_kripke(path, true);
+    std::vector<int> states, loaded_states;
+    kripke.states(states);
+    loaded.states(loaded_states);
+    std::sort(states.begin(), states.end());
+    CHECK(states == loaded_states);
+    for (int s : states) {
+        CHECK(loaded.csr().id(loaded.csr().index(s)) == s);
+    }
+    CHECK(kripke.initial_states() == loaded.initial_states());
+    CHECK(transitions(kripke) == transitions(loaded));
+    CHECK(kripke.labelling_function() == loaded.labelling_function());
+
+    std::vector<std::unordered_set<int>> none;
+    Labelling L, loaded_L;
+    for (int j = 0; j < 3; j++) {
+        std::shared_ptr<Formula> f = random.formula(3);
+        int id = modelcheck(kripke, f, L, none);
+        int loaded_id = modelcheck(loaded, f, loaded_L, none);
+        CHECK(state_ids(kripke, L.at(id)) ==
+              state_ids(loaded, loaded_L.at(loaded_id)));
+    }
+}
+
+static bool rejected(const std::string& bytes, bool validate = false) {
+    write_file(path, bytes);
+    try {
+        load_kripke(path, validate);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+template <typename T>
+static void poke(std::string& bytes, std::uint64_t at, T value) {
+    std::memcpy(&bytes[at], &value, sizeof(value));
+}
+
+static void check_corrupt_files() {
+    ModelData m = TestRandom(7).model(40, 100, true, 0);
+    m.initial.insert(3);
+    save_kripke(m.kripke(), path);
+    const std::string good = read_file(path);
+    KripkeFileHeader h;
+    std::memcpy(&h, good.data(), sizeof(h));
+    test_context = "corrupt file";
+    CHECK(!rejected(good));
+
+    for (std::size_t size = 0; size < good.size(); size++) {
+        test_context = "truncated to " + std::to_string(size) + " bytes";
+        CHECK(rejected(good.substr(0, size)));
+    }
+    test_context = "trailing bytes";
+    CHECK(rejected(good + std::string(8, '\0')));
+
+    std::string bytes = good;
+    bytes[0] = 'X';
+    test_context = "magic";
+    CHECK(rejected(bytes));
+
+    bytes = good;
+    poke(bytes, offsetof(KripkeFileHeader, version), h.version + 1);
+    test_context = "version";
+    CHECK(rejected(bytes));
+
+    // Only a validating open reads the ids and the edges.
+    bytes = good;
+    poke(bytes, h.targets + 4 * 5, std::int32_t(h.num_states));
+    test_context = "target out of range";
+    CHECK(!rejected(bytes) && rejected(bytes, true));
+
+    bytes = good;
+    poke(bytes, h.targets, std::int32_t(-1));
+    test_context = "negative target";
+    CHECK(!rejected(bytes) && rejected(bytes, true));
+
+    bytes = good;
+    poke(bytes, h.offsets + 8 * 10, std::uint64_t(h.num_edges));
+    test_context = "decreasing offsets";
+    CHECK(!rejected(bytes) && rejected(bytes, true));
+
+    bytes = good;
+    poke(bytes, h.ids + 4 * 7, std::int32_t(1000));
+    test_context = "unsorted ids";
+    CHECK(!rejected(bytes) && rejected(bytes, true));
+
+    bytes = good;
+    poke(bytes, h.ids + 4 * 7, std::int32_t(7 * 6 + 3));
+    test_context = "duplicate ids";
+    CHECK(!rejected(bytes) && rejected(bytes, true));
+
+    bytes = good;
+    poke(bytes, h.offsets, std::uint64_t(1));
+    test_context = "first offset";
+    CHECK(rejected(bytes));
+
+    bytes = good;
+    poke(bytes, h.offsets + 8 * h.num_states, std::uint64_t(h.num_edges - 1));
+    test_context = "last offset";
+    CHECK(rejected(bytes));
+
+    bytes = good;
+    poke(bytes, offsetof(KripkeFileHeader, num_edges),
+         std::uint64_t(h.num_edges + 1000000));
+    test_context = "edge count";
+    CHECK(rejected(bytes));
+
+    bytes = good;
+    poke(bytes, h.initial, std::int32_t(h.num_states + 1));
+    test_context = "initial state out of range";
+    CHECK(rejected(bytes));
+
+    bytes = good;
+    poke(bytes, h.ap_names + 8, std::uint64_t(1) << 40);
+    test_context = "AP name out of range";
+    CHECK(rejected(bytes));
+}
+
+int main() {
+    for (unsigned seed = 0; seed < 60; seed++) {
+        test_context = "seed " + std::to_string(seed);
+        TestRandom random(seed);
+        int n = 1 + random.below(seed % 10 == 0 ? 500 : 40);
+        ModelData m = random.model(n, random.below(3 * n + 1), seed % 2, 0);
+        Kripke kripke = m.kripke();
+        check_round_trip(kripke, random);
+    }
+    test_context = "philosophers";
+    TestRandom random(0);
+    Kripke philosophers = philosophers_model(4);
+    check_round_trip(philosophers, random);
+
+    // States added after freezing come last in dense order, so that the
+    // file must renumber them to keep its ids sorted.
+    test_context = "unsorted ids";
+    Kripke edited = TestRandom(1).model(30, 60, true, 0).kripke();
+    edited.freeze();
+    for (int s : {-5, 1000, 2}) {
+        edited.add_edge(s, 3);
+        edited.add_edge(10, s);
+        edited.add_label(s, "p");
+    }
+    check_round_trip(edited, random);
+    check_corrupt_files();
+    std::remove(path);
+    return test_result();
+}
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "libmychecker/checker.h"
+#include "libmychecker/incremental.h"
+#include "libmychecker/session.h"
+#include "tests/test_util.h"
+
+// Edits random Kripke structures between checks and compares the rechecked
+// results of a session with a fresh check of the edited structure.
+
+// Applies one random edit to both `kripke` and `m`.
+static void edit(Kripke& kripke, ModelData& m, TestRandom& random,
+                 int& next_id) {
+    std::vector<int> ids;
+    kripke.states(ids);
+    std::sort(ids.begin(), ids.end());
+    int kind = random.below(6);
+    if (kind <= 2) {
+        int src = kind == 2 ? next_id++ : ids[random.below(ids.size())];
+        int dst = random.below(5) == 0 ? next_id++
+                                       : ids[random.below(ids.size())];
+        if (m.edges.count({src, dst}) != 0) {
+            return;
+        }
+        kripke.add_edge(src, dst);
+        m.edges.emplace(src, dst);
+        for (int s : {src, dst}) {
+            m.states.insert(s);
+            m.labels[s];
+        }
+    } else if (kind == 3) {
+        int s = ids[random.below(ids.size())];
+        const char* aps[] = {"p", "q", "r", "s"};
+        const char* ap = aps[random.below(4)];
+        kripke.add_label(s, ap);
+        m.labels[s].insert(ap);
+    } else if (kind == 4) {
+        const char* aps[] = {"p", "q", "r"};
+        std::string ap = aps[random.below(3)];
+        const CSRGraph& G = kripke.csr();
+        StateSet S(G.size());
+        for (int v = 0; v < G.size(); v++) {
+            if (random.below(3) == 0) {
+                S.insert(v);
+                m.labels[G.id(v)].insert(ap);
+            } else {
+                m.labels[G.id(v)].erase(ap);
+            }
+        }
+        kripke.set_ap_states(ap, std::move(S));
+    } else {
+        int s = next_id++;
+        kripke.add_node(s);
+        m.states.insert(s);
+        m.labels[s];
+    }
+}
+
+static void check_rechecks(unsigned seed) {
+    TestRandom random(seed);
+    int n = 1 + random.below(seed % 10 == 0 ? 200 : 15);
+    ModelData m = random.model(n, random.below(2 * n + 1), seed % 2,
+                               seed % 5 == 4 ? 1 + random.below(2) : 0);
+    Kripke kripke = m.kripke();
+    if (seed % 3 == 0) {
+        kripke.freeze();
+    }
+    CheckOptions options;
+    options.witnesses = seed % 7 == 3;
+    options.num_threads = seed % 4 == 1 ? 3 : 1;
+    if (seed % 11 == 5) {
+        options.engine = CheckEngine::Symbolic;
+    }
+    CheckSession session(kripke, m.fairness, options);
+    std::vector<std::shared_ptr<Formula>> formulas;
+    for (int j = 0; j < 5; j++) {
+        formulas.push_back(random.formula(4));
+    }
+    session.check(formulas);
+
+    int next_id = 100000;
+    for (int round = 0; round < 4; round++) {
+        int edits = 1 + random.below(4);
+        for (int e = 0; e < edits; e++) {
+            edit(kripke, m, random, next_id);
+        }
+        session.recheck();
+        if (round == 1) {
+            formulas.push_back(random.formula(3));
+        }
+        std::vector<int> ids = session.check(formulas);
+
+        Kripke fresh = m.kripke();
+        std::vector<std::unordered_set<int>> F = m.fairness;
+        Labelling L;
+        for (std::size_t j = 0; j < formulas.size(); j++) {
+            test_context = "seed " + std::to_string(seed) + ", round " +
+                           std::to_string(round) + ": " + formulas[j]->str();
+            int id = modelcheck(fresh, formulas[j], L, F);
+            CHECK(state_ids(kripke, session.states(ids[j])) ==
+                  state_ids(fresh, L.at(id)));
+        }
+    }
+}
+
+int main() {
+    for (unsigned seed = 0; seed < 300; seed++) {
+        check_rechecks(seed);
+    }
+    return test_result();
+}
@@ -0,0 +1,81 @@
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "libmychecker/checker.h"
+#include "libmychecker/static_ctl.h"
+#include "tests/test_util.h"
+
+// Checks that StaticCTL::check<P> agrees with modelcheck(to_formula<P>()) on
+// random models, with and without fairness, so that the compile-time
+// rewrite of _Restrict cannot drift from FormulaTable::restricted.
+
+namespace S = StaticCTL;
+
+struct p {
+    static constexpr const char* name = "p";
+};
+struct q {
+    static constexpr const char* name = "q";
+};
+struct r {
+    static constexpr const char* name = "r";
+};
+using ApP = S::Ap<p>;
+using ApQ = S::Ap<q>;
+using ApR = S::Ap<r>;
+
+template <class... Properties>
+struct PropertyList {};
+
+using Properties = PropertyList<
+    S::AG<ApP>, S::EF<ApQ>, S::EG<ApP>, S::AF<ApQ>, S::EX<ApR>, S::AX<ApR>,
+    S::EU<ApP, ApQ>, S::AU<ApP, ApQ>, S::ER<ApP, ApQ>, S::AR<ApP, ApQ>,
+    S::Not<S::EG<ApP>>, S::AG<S::Imply<ApP, S::AF<ApQ>>>, S::AG<S::EF<ApR>>,
+    S::EF<S::AG<ApP>>, S::EG<S::Or<ApP, S::EX<ApQ>>>,
+    S::AU<S::And<ApP, S::Not<ApR>>, S::EG<ApQ>>,
+    S::ER<S::AF<ApP>, S::EU<ApQ, ApR>>,
+    S::AR<S::EG<ApR>, S::Or<ApP, S::AX<ApQ>>>,
+    S::EU<S::AG<ApP>, S::AR<ApQ, ApR>>,
+    S::And<S::ER<ApP, ApR>, S::AF<S::EG<ApQ>>>,
+    S::Not<S::AU<S::Not<ApP>, S::Imply<ApQ, S::EF<ApR>>>>,
+    S::AG<S::AU<S::True, S::EG<S::Not<S::False>>>>>;
+
+template <class Property>
+static void check_property(Kripke& kripke, Labelling& L,
+                           std::vector<std::unordered_set<int>>& F,
+                           const std::string& context) {
+    std::shared_ptr<Formula> formula = S::to_formula<Property>();
+    test_context = context + ": " + formula->str();
+    int id = modelcheck(kripke, formula, L, F);
+    CHECK(S::check<Property>(kripke, L) == L.at(id));
+}
+
+template <class... Properties>
+static void check_properties(PropertyList<Properties...>, Kripke& kripke,
+                             Labelling& L,
+                             std::vector<std::unordered_set<int>>& F,
+                             const std::string& context) {
+    int expand[] = {(check_property<Properties>(kripke, L, F, context), 0)...};
+    (void)expand;
+}
+
+int main() {
+    for (unsigned seed = 0; seed < 200; seed++) {
+        TestRandom random(seed);
+        int n = 1 + random.below(seed % 20 == 0 ? 400 : 30);
+        bool fair = seed % 2 == 1;
+        ModelData m = random.model(n, random.below(3 * n + 1), seed % 3 == 0,
+                                   fair ? 1 + random.below(3) : 0);
+        Kripke kripke = m.kripke();
+        std::vector<std::unordered_set<int>> F = m.fairness;
+        Labelling L;
+        if (seed % 4 == 3) {
+            L.options.scc.algorithm = SCCAlgorithm::ForwardBackward;
+        }
+        check_properties(Properties(), kripke, L, F,
+                         "seed " + std::to_string(seed));
+    }
+    return test_result();
+}
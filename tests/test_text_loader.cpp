@@ -0,0 +1,131 @@
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "libmychecker/text_loader.h"
+#include "tests/test_util.h"
+
+// Writes random models as edge and label files, with comments, blank lines
+// and duplicate transitions mixed in, loads them with several threads and
+// compares the result with the model. Ids are dense, spread out or random
+// 32-bit ints, so that both the bitmap and the radix tree number them.
+
+static const char* edges_path = "test_text_loader.edges";
+static const char* labels_path = "test_text_loader.labels";
+
+static void write_file(const std::string& name, const std::string& text) {
+    std::ofstream out(name, std::ios::binary | std::ios::trunc);
+    out << text;
+}
+
+static std::set<std::pair<int, int>> transitions(const Kripke& kripke) {
+    std::vector<std::pair<int, int>> R;
+    kripke.transitions(R);
+    return std::set<std::pair<int, int>>(R.begin(), R.end());
+}
+
+static int random_id(TestRandom& random) {
+    return int(unsigned(random.below(1 << 16)) << 16 |
+               unsigned(random.below(1 << 16)));
+}
+
+static void check_round_trip(unsigned seed, ThreadPool& pool) {
+    TestRandom random(seed);
+    int n = 1 + random.below(seed % 10 == 0 ? 3000 : 60);
+    ModelData m = random.model(n, random.below(3 * n + 1), seed % 3 == 1, 0);
+    if (seed % 3 == 2) {
+        // Random ids over the whole int range.
+        std::unordered_map<int, int> renamed;
+        std::unordered_set<int> used;
+        for (int s : m.states) {
+            int id = random_id(random);
+            while (!used.insert(id).second) {
+                id = random_id(random);
+            }
+            renamed[s] = id;
+        }
+        ModelData r;
+        for (int s : m.states) {
+            r.states.insert(renamed[s]);
+            r.labels[renamed[s]] = m.labels[s];
+        }
+        for (int s : m.initial) {
+            r.initial.insert(renamed[s]);
+        }
+        for (const auto& e : m.edges) {
+            r.edges.emplace(renamed[e.first], renamed[e.second]);
+        }
+        m = r;
+    }
+
+    // States without transitions appear in the label file only.
+    std::string edges = "# transitions\n\n";
+    for (const auto& e : m.edges) {
+        edges += std::to_string(e.first) + " " + std::to_string(e.second);
+        edges += random.below(4) == 0 ? "\r\n" : "\n";
+        if (random.below(5) == 0) {
+            edges += "\t" + std::to_string(e.first) + "\t" +
+                     std::to_string(e.second) + " \n";
+        }
+    }
+    std::string labels;
+    for (const auto& label : m.labels) {
+        labels += std::to_string(label.first);
+        for (const std::string& ap : label.second) {
+            labels += " " + ap;
+        }
+        labels += "\n";
+    }
+    write_file(edges_path, edges);
+    write_file(labels_path, labels);
+
+    test_context = "seed " + std::to_string(seed);
+    LoadOptions options;
+    options.pool = &pool;
+    LoadStats stats;
+    Kripke kripke = load_text_kripke(edges_path, labels_path, m.initial,
+                                     &stats, options);
+    std::vector<int> states;
+    kripke.states(states);
+    CHECK(std::set<int>(states.begin(), states.end()) ==
+          std::set<int>(m.states.begin(), m.states.end()));
+    CHECK(stats.states == m.states.size() && stats.edges == m.edges.size());
+    CHECK(kripke.initial_states() == m.initial);
+    CHECK(transitions(kripke) == m.edges);
+    CHECK(kripke.labelling_function() == m.labels);
+}
+
+static bool rejected(const std::string& edges) {
+    write_file(edges_path, edges);
+    try {
+        load_text_kripke(edges_path, "", {});
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+int main() {
+    ThreadPool pool(4);
+    for (unsigned seed = 0; seed < 90; seed++) {
+        check_round_trip(seed, pool);
+    }
+
+    test_context = "malformed";
+    CHECK(!rejected("-2147483648 2147483647\n"));
+    CHECK(rejected("2147483648 1\n"));
+    CHECK(rejected("1 -2147483649\n"));
+    CHECK(rejected("1 99999999999999999999999\n"));
+    CHECK(rejected("1 2 3\n"));
+    CHECK(rejected("1\n"));
+    CHECK(rejected("a 1\n"));
+    std::remove(edges_path);
+    std::remove(labels_path);
+    return test_result();
+}
@@ -0,0 +1,137 @@
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "libmychecker/checker.h"
+#include "libmychecker/trace.h"
+#include "tests/test_util.h"
+
+// Checks that witnesses and counterexamples are paths of the model through
+// the states their formula requires, starting in the state they explain,
+// and that lassos under fairness visit every fairness set on their cycle.
+
+static bool is_path(const CSRGraph& G, const Trace& trace, int v) {
+    if (trace.states.empty() || trace.states[0] != v) {
+        return false;
+    }
+    for (std::size_t i = 0; i + 1 < trace.states.size(); i++) {
+        if (!G.has_edge(trace.states[i], trace.states[i + 1])) {
+            return false;
+        }
+    }
+    return trace.loop == -1 ||
+           (trace.loop < int(trace.states.size()) &&
+            G.has_edge(trace.states.back(), trace.states[trace.loop]));
+}
+
+// Whether the cycle of a lasso meets every fairness set of L.
+static bool is_fair_cycle(const Labelling& L, const Trace& trace) {
+    for (const StateSet& P : L.fairness) {
+        bool found = false;
+        for (std::size_t i = trace.loop; i < trace.states.size(); i++) {
+            found = found || P.contains(trace.states[i]);
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool all_in(const Trace& trace, std::size_t first, std::size_t last,
+                   const StateSet& S) {
+    for (std::size_t i = first; i < last; i++) {
+        if (!S.contains(trace.states[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void check_traces(unsigned seed) {
+    TestRandom random(seed);
+    int n = seed % 20 == 0 ? 200 + random.below(200) : 1 + random.below(15);
+    bool fair = seed % 3 == 1;
+    ModelData m = random.model(n, random.below(3 * n + 1), seed % 2,
+                               fair ? 1 + random.below(3) : 0);
+    Kripke kripke = m.kripke();
+    const CSRGraph& G = kripke.csr();
+    std::vector<std::unordered_set<int>> F = m.fairness;
+    Labelling L;
+    L.options.witnesses = true;
+    if (seed % 4 == 2) {
+        L.options.num_threads = 3;
+    }
+    if (seed % 5 == 3) {
+        L.options.scc.algorithm = SCCAlgorithm::ForwardBackward;
+    }
+
+    std::shared_ptr<Formula> phi = random.formula(2);
+    std::shared_ptr<Formula> psi = random.formula(2);
+    const StateSet& in_phi = L.at(modelcheck(kripke, phi, L, F));
+    const StateSet& in_psi = L.at(modelcheck(kripke, psi, L, F));
+    auto not_phi = std::make_shared<CTL::Not>(phi);
+    const StateSet& out_phi = L.at(modelcheck(kripke, not_phi, L, F));
+    // The end of a finite witness must have a fair continuation.
+    const StateSet* ends = fair ? &L.fair : nullptr;
+    auto ends_fairly = [&](const Trace& trace) {
+        return ends == nullptr || ends->contains(trace.states.back());
+    };
+
+    auto for_each_state = [&](std::shared_ptr<Formula> f, bool holds,
+                              const std::function<void(int, int)>& body) {
+        int id = modelcheck(kripke, f, L, F);
+        test_context = "seed " + std::to_string(seed) + ": " + f->str();
+        for (int v = 0; v < G.size(); v++) {
+            if (L.at(id).contains(v) == holds) {
+                body(id, v);
+            }
+        }
+    };
+
+    for_each_state(CTL::EX(phi), true, [&](int id, int v) {
+        Trace t = witness(kripke, L, id, v);
+        CHECK(is_path(G, t, v) && t.loop == -1 && t.states.size() == 2);
+        CHECK(in_phi.contains(t.states.back()) && ends_fairly(t));
+    });
+    for_each_state(CTL::EU(phi, psi), true, [&](int id, int v) {
+        Trace t = witness(kripke, L, id, v);
+        CHECK(is_path(G, t, v) && t.loop == -1);
+        CHECK(all_in(t, 0, t.states.size() - 1, in_phi));
+        CHECK(in_psi.contains(t.states.back()) && ends_fairly(t));
+    });
+    for_each_state(CTL::EG(phi), true, [&](int id, int v) {
+        Trace t = witness(kripke, L, id, v);
+        CHECK(is_path(G, t, v) && t.loop != -1);
+        CHECK(all_in(t, 0, t.states.size(), in_phi));
+        CHECK(is_fair_cycle(L, t));
+    });
+
+    // Counterexamples to universal properties.
+    for_each_state(CTL::AX(phi), false, [&](int id, int v) {
+        Trace t = counterexample(kripke, L, id, v);
+        CHECK(is_path(G, t, v) && t.loop == -1 && t.states.size() == 2);
+        CHECK(out_phi.contains(t.states.back()) && ends_fairly(t));
+    });
+    auto AG = std::make_shared<CTL::A>(std::make_shared<CTL::G>(phi));
+    for_each_state(AG, false, [&](int id, int v) {
+        Trace t = counterexample(kripke, L, id, v);
+        CHECK(is_path(G, t, v) && t.loop == -1);
+        CHECK(out_phi.contains(t.states.back()) && ends_fairly(t));
+    });
+    for_each_state(CTL::AF(phi), false, [&](int id, int v) {
+        Trace t = counterexample(kripke, L, id, v);
+        CHECK(is_path(G, t, v) && t.loop != -1);
+        CHECK(all_in(t, 0, t.states.size(), out_phi));
+        CHECK(is_fair_cycle(L, t));
+    });
+}
+
+int main() {
+    for (unsigned seed = 0; seed < 300; seed++) {
+        check_traces(seed);
+    }
+    return test_result();
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "libmychecker/formula.h"
+#include "libmychecker/kripke.h"
+#include "libmychecker/stateset.h"
+
+// Shared support for the tests. There is no test framework: CHECK reports a
+// failed condition together with test_context and carries on, and main
+// returns test_result().
+
+static std::string test_context;
+static int test_failures = 0;
+
+#define CHECK(condition)                                                 \
+    do {                                                                 \
+        if (!(condition)) {                                              \
+            std::fprintf(stderr, "%s:%d: %s failed (%s)\n", __FILE__,    \
+                         __LINE__, #condition, test_context.c_str());    \
+            test_failures++;                                             \
+        }                                                                \
+    } while (0)
+
+inline int test_result() {
+    if (test_failures != 0) {
+        std::fprintf(stderr, "%d checks failed\n", test_failures);
+        return 1;
+    }
+    return 0;
+}
+
+// The ids of the states in S, a set over the dense indices of `kripke`, so
+// that results on differently numbered structures can be compared.
+inline std::set<int> state_ids(const Kripke& kripke, const StateSet& S) {
+    const CSRGraph& G = kripke.csr();
+    std::set<int> result;
+    S.for_each([&](int v) { result.insert(G.id(v)); });
+    return result;
+}
+
+// A Kripke structure as plain data, so that tests can edit it alongside a
+// Kripke object and rebuild it from scratch.
+struct ModelData {
+    std::unordered_set<int> states;
+    std::unordered_set<int> initial;
+    std::set<std::pair<int, int>> edges;
+    std::unordered_map<int, std::unordered_set<std::string>> labels;
+    std::vector<std::unordered_set<int>> fairness;
+
+    Kripke kripke() const {
+        std::vector<std::pair<int, int>> R(edges.begin(), edges.end());
+        return Kripke(states, initial, R, labels);
+    }
+};
+
+// Random models over the APs p, q and r and random CTL formulas over them.
+class TestRandom {
+   public:
+    explicit TestRandom(unsigned seed) : _rng(seed) {}
+
+    int below(int n) {
+        return std::uniform_int_distribution<int>(0, n - 1)(_rng);
+    }
+
+    // n states with ids 0..n-1, or spread out if `sparse_ids`, about
+    // `num_edges` edges (deadlocks included) and `num_fairness` fairness
+    // sets.
+    ModelData model(int n, int num_edges, bool sparse_ids,
+                    int num_fairness) {
+        ModelData m;
+        std::vector<int> ids;
+        for (int i = 0; i < n; i++) {
+            ids.push_back(sparse_ids ? 7 * i + 3 : i);
+            m.states.insert(ids.back());
+            m.labels[ids.back()];
+        }
+        for (int i = 0; i < num_edges; i++) {
+            m.edges.emplace(ids[below(n)], ids[below(n)]);
+        }
+        for (int s : ids) {
+            for (const char* ap : {"p", "q", "r"}) {
+                if (below(3) == 0) {
+                    m.labels[s].insert(ap);
+                }
+            }
+            if (below(4) == 0) {
+                m.initial.insert(s);
+            }
+        }
+        for (int k = 0; k < num_fairness; k++) {
+            m.fairness.emplace_back();
+            for (int s : ids) {
+                if (below(3) == 0) {
+                    m.fairness.back().insert(s);
+                }
+            }
+        }
+        return m;
+    }
+
+    std::shared_ptr<Formula> formula(int depth) {
+        if (depth == 0 || below(5) == 0) {
+            int k = below(7);
+            if (k == 0) {
+                return std::make_shared<CTL::Bool>(below(2) == 0);
+            }
+            const char* aps[] = {"p", "q", "r"};
+            return std::make_shared<CTL::AtomicProposition>(aps[k % 3]);
+        }
+        std::shared_ptr<Formula> a = formula(depth - 1);
+        switch (below(14)) {
+            case (0):
+                return std::make_shared<CTL::Not>(a);
+            case (1):
+                return std::make_shared<CTL::Or>(a, formula(depth - 1));
+            case (2):
+                return std::make_shared<CTL::And>(a, formula(depth - 1));
+            case (3):
+                return std::make_shared<CTL::Imply>(a, formula(depth - 1));
+            case (4):
+                return CTL::EX(a);
+            case (5):
+                return CTL::AX(a);
+            case (6):
+                return CTL::EF(a);
+            case (7):
+                return CTL::AF(a);
+            case (8):
+                return CTL::EG(a);
+            case (9):
+                return std::make_shared<CTL::A>(std::make_shared<CTL::G>(a));
+            case (10):
+                return CTL::EU(a, formula(depth - 1));
+            case (11):
+                return CTL::AU(a, formula(depth - 1));
+            case (12):
+                return CTL::ER(a, formula(depth - 1));
+            default:
+                return CTL::AR(a, formula(depth - 1));
+        }
+    }
+
+   private:
+    std::mt19937 _rng;
+};